@@ -0,0 +1,101 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_arena.h
+ *    Description:  region allocator for short-lived scratch memory
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s (), peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+/*
+ * Bump-pointer allocation out of chunks, nothing is freed one by one:
+ * dt_arena_reset drops every allocation at once, dt_arena_rollback drops
+ * those made after a dt_arena_mark. Chunks are kept and reused after
+ * reset/rollback, so a steady per-frame workload stops calling malloc.
+ * An arena is not thread safe, use one per thread / per pipeline stage.
+ */
+
+#ifndef DT_ARENA_H
+#define DT_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DT_ARENA_ALIGN 16
+
+typedef struct dt_arena dt_arena_t;
+
+typedef struct {
+    void *chunk;
+    size_t used;
+} dt_arena_mark_t;
+
+/* *
+ * Create arena
+ *
+ * @param chunk_size bytes per chunk, bigger requests get their own chunk
+ *
+ * @return arena pointer for success, NULL otherwise
+ *
+ */
+dt_arena_t *dt_arena_create(size_t chunk_size);
+void dt_arena_destroy(dt_arena_t *arena);
+
+/* *
+ * Allocate size bytes, DT_ARENA_ALIGN aligned (align: power of two)
+ *
+ * @return pointer, NULL if out of memory
+ *
+ */
+void *dt_arena_alloc(dt_arena_t *arena, size_t size);
+void *dt_arena_alloc_align(dt_arena_t *arena, size_t size, size_t align);
+void *dt_arena_mallocz(dt_arena_t *arena, size_t size);
+
+/* *
+ * Grow or shrink an arena block, in place when ptr is the last allocation
+ *
+ * @param ptr      block from this arena or NULL
+ * @param old_size size of ptr
+ * @param size     new size
+ *
+ * @return new pointer, NULL if out of memory (ptr stays valid)
+ *
+ */
+void *dt_arena_realloc(dt_arena_t *arena, void *ptr, size_t old_size, size_t size);
+
+/* *
+ * Drop every allocation, chunks are kept for reuse
+ */
+void dt_arena_reset(dt_arena_t *arena);
+
+/* *
+ * Drop allocations made after mark
+ */
+dt_arena_mark_t dt_arena_mark(dt_arena_t *arena);
+void dt_arena_rollback(dt_arena_t *arena, dt_arena_mark_t mark);
+
+/* *
+ * Bytes handed out / bytes held in chunks
+ */
+size_t dt_arena_used(dt_arena_t *arena);
+size_t dt_arena_size(dt_arena_t *arena);
+
+/* arena counterparts of dt_mem.h / dt_array.h helpers */
+char *dt_arena_strdup(dt_arena_t *arena, const char *s);
+char *dt_arena_strndup(dt_arena_t *arena, const char *s, size_t len);
+void *dt_arena_memdup(dt_arena_t *arena, const void *p, size_t size);
+
+/* *
+ * dt_dynarray2_add on arena memory, array grows by doubling
+ * on failure the array is left unchanged and NULL is returned
+ */
+void *dt_arena_dynarray2_add(dt_arena_t *arena, void **tab_ptr, int *nb_ptr,
+                             size_t elem_size, const uint8_t *elem_data);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef DT_ATOMIC_H
+#define DT_ATOMIC_H
+
+/*
+ * Thin wrappers over the gcc __atomic builtins
+ * keep memory order explicit at call site
+ */
+
+#define DT_CACHELINE_SIZE 64
+
+#define dt_atomic_load(x)             __atomic_load_n(x, __ATOMIC_RELAXED)
+#define dt_atomic_load_acquire(x)     __atomic_load_n(x, __ATOMIC_ACQUIRE)
+#define dt_atomic_store(x,v)          __atomic_store_n(x, v, __ATOMIC_RELAXED)
+#define dt_atomic_store_release(x,v)  __atomic_store_n(x, v, __ATOMIC_RELEASE)
+
+/* sequentially consistent ops, for store-then-load handshakes */
+#define dt_atomic_load_seq(x)         __atomic_load_n(x, __ATOMIC_SEQ_CST)
+#define dt_atomic_store_seq(x,v)      __atomic_store_n(x, v, __ATOMIC_SEQ_CST)
+#define dt_atomic_fetch_add(x,v)      __atomic_fetch_add(x, v, __ATOMIC_SEQ_CST)
+#define dt_atomic_fetch_sub(x,v)      __atomic_fetch_sub(x, v, __ATOMIC_SEQ_CST)
+#define dt_atomic_fetch_or(x,v)       __atomic_fetch_or(x, v, __ATOMIC_SEQ_CST)
+#define dt_atomic_fetch_and(x,v)      __atomic_fetch_and(x, v, __ATOMIC_SEQ_CST)
+
+#define dt_atomic_exchange(x,v)       __atomic_exchange_n(x, v, __ATOMIC_SEQ_CST)
+#define dt_atomic_fence()             __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define dt_atomic_fence_acquire()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define dt_atomic_fence_release()     __atomic_thread_fence(__ATOMIC_RELEASE)
+
+/* weak cas, on failure *e is updated with current value */
+#define dt_atomic_cas_weak(x,e,v) \
+    __atomic_compare_exchange_n(x, e, v, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/* spin-wait hint */
+#if defined(__i386__) || defined(__x86_64__)
+#define dt_cpu_relax() __builtin_ia32_pause()
+#elif defined(__arm__) || defined(__aarch64__)
+#define dt_cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define dt_cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+#endif
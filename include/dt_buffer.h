@@ -1,6 +1,7 @@
 #ifndef DT_BUFFER_T
 #define DT_BUFFER_T
 
+#include "dt_atomic.h"
 #include "dt_lock.h"
 #include "dt_macro.h"
 
@@ -11,6 +12,20 @@
 #include <stdio.h>
 #include <string.h>
 
+/*
+ * DTBUF_FLAG_SPSC
+ * one producer thread calls dtbuf_put, one consumer thread calls dtbuf_get
+ * read/write positions published with acquire/release atomics, no mutex
+ */
+#define DTBUF_FLAG_SPSC   0x1
+
+/*
+ * DTBUF_FLAG_MIRROR
+ * data mapped twice back-to-back (dt_mirror_alloc), size rounded up to page
+ * size, every readable/writable region is one contiguous span
+ */
+#define DTBUF_FLAG_MIRROR 0x2
+
 typedef struct {
     uint8_t *data;
     int size;
@@ -18,13 +33,42 @@ typedef struct {
     uint8_t *rd_ptr;
     uint8_t *wr_ptr;
     dt_lock_t mutex;
+    int flags;
+
+    /* SPSC mode only: positions run in [0, 2 * size), one writer each */
+    uint32_t rd_pos;
+    uint8_t pad[DT_CACHELINE_SIZE - sizeof(uint32_t)];
+    uint32_t wr_pos;
 } dt_buffer_t;
 
+/*
+ * Zero-copy view of the ring: [ptr[0], len[0]) then [ptr[1], len[1])
+ * len[1] is non-zero only when the region wraps at data + size,
+ * never for DTBUF_FLAG_MIRROR
+ */
+typedef struct {
+    uint8_t *ptr[2];
+    int len[2];
+} dtbuf_span_t;
+
 int dtbuf_init(dt_buffer_t * dbt, int size);
+int dtbuf_init2(dt_buffer_t * dbt, int size, int flags);
 int dtbuf_reinit(dt_buffer_t * dbt);
 int dtbuf_release(dt_buffer_t * dbt);
 int dtbuf_space(dt_buffer_t * dbt);
 int dtbuf_level(dt_buffer_t * dbt);
 int dtbuf_get(dt_buffer_t * dbt, uint8_t * out, int size);
 int dtbuf_put(dt_buffer_t * dbt, uint8_t * in, int size);
+
+/*
+ * Writer side: reserve returns free bytes described by span (<= size),
+ * fill them in place, then commit the bytes actually written.
+ * Reader side: peek returns readable bytes described by span (<= size),
+ * parse in place, then consume the bytes no longer needed.
+ * One writer and one reader at a time, commit/consume return 0 or -1.
+ */
+int dtbuf_reserve(dt_buffer_t * dbt, dtbuf_span_t * span, int size);
+int dtbuf_commit(dt_buffer_t * dbt, int size);
+int dtbuf_peek(dt_buffer_t * dbt, dtbuf_span_t * span, int size);
+int dtbuf_consume(dt_buffer_t * dbt, int size);
 #endif
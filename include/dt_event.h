@@ -3,10 +3,18 @@
 
 #include "dt_lock.h"
 
+/* event priority, higher lane delivered first */
+#define EVENT_PRIORITY_LOW     0
+#define EVENT_PRIORITY_NORMAL  1
+#define EVENT_PRIORITY_HIGH    2
+#define EVENT_PRIORITY_URGENT  3
+#define EVENT_PRIORITY_NUM     4
+
 typedef struct event {
     int type;
     unsigned long arg;
     int server_id;
+    int priority;               // EVENT_PRIORITY_*, NORMAL from dt_alloc_event
     struct event *next;
 } event_t;
 
@@ -15,8 +23,13 @@ typedef struct event {
 typedef struct event_server {
     char name[MAX_EVENT_SERVER_NAME_LEN];
     int id;
-    event_t *event;
+    event_t *event[EVENT_PRIORITY_NUM];         // one FIFO lane per priority
+    event_t *event_tail[EVENT_PRIORITY_NUM];    // lane tail, valid if lane not empty
+    int coalesce;               // merge same type pending events, keep last arg
+    event_t *inbox;             // DT_EVENT_FLAG_DIRECT senders push here, newest first
     dt_lock_t event_lock;
+    pthread_cond_t event_cond;  // signalled when event added
+    int waiters;
     int event_count;
     struct event_server *next;
 } event_server_t;
@@ -24,12 +37,29 @@ typedef struct event_server {
 #define EVENT_SERVER_ID_MAIN   0
 #define EVENT_SERVER_NAME_MAIN "SERVER-MAIN"
 
+/*
+ * DT_EVENT_FLAG_DIRECT
+ * every send goes straight to the destination server's lock-free inbox,
+ * no main-server hop and no transport thread, receivers drain the inbox
+ * under their event_lock
+ */
+#define DT_EVENT_FLAG_DIRECT 0x1
+
+struct event_route;
+
 typedef struct event_server_mgt {
     event_server_t *server;
     dt_lock_t server_lock;
     int server_count;
     int exit_flag;
+    int flags;
     pthread_t transport_loop_id;
+
+    /*
+     * id -> server hash snapshot, rebuilt under server_lock on register/remove
+     * routing reads it without server_lock, see route_read_lock in dt_event.c
+     */
+    struct event_route *route;
 } dt_server_mgt_t;
 
 
@@ -45,6 +75,16 @@ typedef struct event_server_mgt {
  */
 dt_server_mgt_t *dt_event_server_create();
 
+/* *
+ * Create server manager context with DT_EVENT_FLAG_* flags
+ *
+ * @param flags DT_EVENT_FLAG_DIRECT or 0
+ *
+ * @return dt_server_mgt_t pointer for success, NULL otherwise
+ *
+ */
+dt_server_mgt_t *dt_event_server_create2(int flags);
+
 /* *
  * Release server manager context
  * Just release server manager and main server, guarantee
@@ -68,6 +108,17 @@ int dt_event_server_release(dt_server_mgt_t *mgt);
  */
 event_server_t *dt_alloc_server(int id, char *name);
 
+/* *
+ * Enable or disable coalescing on server
+ * an incoming event whose type is already pending in the same priority
+ * lane only updates the pending event's arg and is released
+ *
+ * @param server server context
+ * @param enable 1 to merge, 0 to queue every event
+ *
+ */
+void dt_server_set_coalesce(event_server_t * server, int enable);
+
 /* *
  * Register server to server manager
  *
@@ -87,12 +138,14 @@ int dt_register_server(dt_server_mgt_t *mgt, event_server_t * server);
  * @param server server to be removed
  *
  * @return 0 for success, negative errorcode otherwise
+ *         on failure server stays registered and valid
  *
  */
 int dt_remove_server(dt_server_mgt_t *mgt, event_server_t * server);
 
 /* *
  * Alloc an event_t
+ * taken from the calling thread's event cache when possible
  *
  * @param server event server to be sent
  * @param type   event type
@@ -102,6 +155,15 @@ int dt_remove_server(dt_server_mgt_t *mgt, event_server_t * server);
  */
 event_t *dt_alloc_event(int server, int type);
 
+/* *
+ * Give a handled event back to the event pool
+ * free() is still accepted for events, but defeats the pool
+ *
+ * @param event event returned by dt_get_event, may be NULL
+ *
+ */
+void dt_release_event(event_t * event);
+
 /* *
  * Send event to server manger, and make sure event
  * transport dest server before return
@@ -125,8 +187,33 @@ int dt_send_event_sync(dt_server_mgt_t *mgt, event_t * event);
  */
 int dt_send_event(dt_server_mgt_t *mgt, event_t * event);
 
+/* *
+ * Send a chain of events linked by event->next, routed in one pass
+ * events for the same server keep their chain order
+ *
+ * @param mgt   server manager context
+ * @param event first event of the chain, last one has next == NULL
+ *
+ * @return 0 for success, negative errorcode otherwise
+ *
+ */
+int dt_send_event_batch_sync(dt_server_mgt_t *mgt, event_t * event);
+
+/* *
+ * Send a chain of events to server manager - non block
+ * the chain is queued on main server with one lock round-trip
+ *
+ * @param mgt   server manager context
+ * @param event first event of the chain, last one has next == NULL
+ *
+ * @return 0 for success, negative errorcode otherwise
+ *
+ */
+int dt_send_event_batch(dt_server_mgt_t *mgt, event_t * event);
+
 /* *
  * Get event from server
+ * highest priority lane first, FIFO inside a lane
  *
  * @param server server context
  *
@@ -136,6 +223,18 @@ int dt_send_event(dt_server_mgt_t *mgt, event_t * event);
  */
 event_t *dt_get_event(event_server_t * server);
 
+/* *
+ * Get event from server, wait until event arrives
+ *
+ * @param server  server context
+ * @param timeout millisecond, <= 0 wait forever
+ *
+ * @return first event pointer for success, NULL on timeout
+ * remove event from server
+ *
+ */
+event_t *dt_get_event_timeout(event_server_t * server, int timeout);
+
 /* *
  * Query event from server
  *
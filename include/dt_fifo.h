@@ -26,10 +26,14 @@
 
 #include "dt_mem.h"
 
+/* buffer mapped twice back-to-back, see dt_mirror_alloc() */
+#define DT_FIFO_FLAG_MIRROR 0x1
+
 typedef struct dt_fifo {
     uint8_t *buffer;
     uint8_t *rptr, *wptr, *end;
     uint32_t rndx, wndx;
+    int flags;
 } dt_fifo;
 
 /**
@@ -47,6 +51,15 @@ dt_fifo *dt_fifo_alloc(unsigned int size);
  */
 dt_fifo *dt_fifo_alloc_array(size_t nmemb, size_t size);
 
+/**
+ * Initialize an dt_fifo backed by a mirrored mapping.
+ * Any readable or writable span is contiguous in memory, so reads and
+ * writes never split at the end of the buffer.
+ * @param size of FIFO, rounded up to the page size
+ * @return dt_fifo or NULL if not supported or in case of failure
+ */
+dt_fifo *dt_fifo_alloc_mirror(unsigned int size);
+
 /**
  * Free an dt_fifo.
  * @param f dt_fifo to free
@@ -163,10 +176,15 @@ void dt_fifo_drain(dt_fifo *f, int size);
  *             than the used buffer size or the returned pointer will
  *             point outside to the buffer data.
  *             The used buffer size can be checked with dt_fifo_size().
+ *             For a mirrored FIFO a non-negative offset never wraps and
+ *             the returned pointer is valid for dt_fifo_size() - offs bytes.
  */
 static inline uint8_t *dt_fifo_peek2(const dt_fifo *f, int offs)
 {
     uint8_t *ptr = f->rptr + offs;
+    if ((f->flags & DT_FIFO_FLAG_MIRROR) && offs >= 0) {
+        return ptr;
+    }
     if (ptr >= f->end) {
         ptr = f->buffer + (ptr - f->end);
     } else if (ptr < f->buffer) {
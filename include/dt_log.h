@@ -34,6 +34,66 @@ void dt_info(void *tag, const char *fmt, ...);  // default info level
 
 void dt_set_log_level(int level);
 void dt_get_log_level(int level);
+
+/*
+ * Level-checked front ends
+ * below DT_LOG_COMPILE_LEVEL the call and its arguments compile away,
+ * above it the runtime level is tested inline before any argument is
+ * evaluated. build with -DDT_LOG_COMPILE_LEVEL=DT_LOG_INFO to drop debug
+ * and warning lines from the binary.
+ */
+#ifndef DT_LOG_COMPILE_LEVEL
+#define DT_LOG_COMPILE_LEVEL DT_LOG_DEBUG
+#endif
+
+extern int dt_log_level;       // runtime level, set by dt_set_log_level
+
+#define DT_LOG_ON(level) \
+    ((level) >= DT_LOG_COMPILE_LEVEL && __builtin_expect((level) >= dt_log_level, 0))
+
+#define DT_LOGD(tag, ...) do { if (DT_LOG_ON(DT_LOG_DEBUG)) dt_debug(tag, __VA_ARGS__); } while (0)
+#define DT_LOGW(tag, ...) do { if (DT_LOG_ON(DT_LOG_WARNING)) dt_warning(tag, __VA_ARGS__); } while (0)
+#define DT_LOGI(tag, ...) do { if (DT_LOG_ON(DT_LOG_INFO)) dt_info(tag, __VA_ARGS__); } while (0)
+#define DT_LOGE(tag, ...) do { if (DT_LOG_ON(DT_LOG_ERROR)) dt_error(tag, __VA_ARGS__); } while (0)
+
+/*
+ * Every call emits one complete line. Sync mode (default) writes it from
+ * the calling thread; async mode queues it in a per-thread ring and a
+ * writer thread batches all rings into the sink with writev.
+ */
+
+/*
+ * line timestamp
+ * WALL:         [YYYY-mm-dd HH:MM:SS], rebuilt once a second (default)
+ * MONO:         [seconds.microseconds] of dt_gettime_relative
+ * WALL_NOCACHE: WALL formatted on every line
+ */
+#define DT_LOG_TIME_WALL         0
+#define DT_LOG_TIME_MONO         1
+#define DT_LOG_TIME_WALL_NOCACHE 2
+
+void dt_log_set_time(int mode);
+
+/* *
+ * Set the sink fd for both modes, -1 for stdout (default)
+ * the caller keeps fd open until logging to it ends
+ */
+void dt_log_set_sink(int fd);
+
+/* *
+ * Start the writer thread
+ *
+ * @param ring_size per-thread ring bytes, 0 for default (64KB)
+ *
+ * @return 0 for success, -1 otherwise
+ *
+ */
+int dt_log_async_start(int ring_size);
+
+/* *
+ * Flush queued lines and stop the writer thread, back to sync mode
+ */
+void dt_log_async_stop(void);
 #endif
 
 #endif
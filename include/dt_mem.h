@@ -13,7 +13,11 @@
  * =====================================================================================
  */
 
+#ifndef DT_MEM_H
+#define DT_MEM_H
+
 #include <limits.h>
+#include <stdint.h>
 
 #include "dt_error.h"
 
@@ -54,6 +58,13 @@ dt_alloc_size(1, 2) static inline void *dt_malloc_array(size_t nmemb, size_t siz
 }
 
 void *dt_realloc(void *ptr, size_t size);
+
+/**
+ * Set the largest block size that may be allocated, INT_MAX by default.
+ * A failed realloc leaves the old block untouched, as realloc() does.
+ */
+void dt_max_alloc(size_t max);
+
 void *dt_realloc_f(void *ptr, size_t nelem, size_t elsize);
 int dt_reallocp(void *ptr, size_t size);
 void *dt_realloc_array(void *ptr, size_t nmemb, size_t size);
@@ -65,3 +76,84 @@ void *dt_calloc(size_t nmemb, size_t size);
 char *dt_strdup(const char *s);
 char *dt_strndup(const char *s, size_t len);
 void *dt_memdup(const void *p, size_t size);
+
+/**
+ * Allocate a ring backing store whose pages are mapped twice back-to-back,
+ * so that ptr[i] and ptr[i + *size] alias for any i in [0, *size).
+ * @param size in: minimum size, out: actual size (rounded up to page size)
+ * @return base pointer, NULL if not supported or in case of failure
+ */
+void *dt_mirror_alloc(size_t *size);
+
+/**
+ * Release memory from dt_mirror_alloc().
+ * @param size size returned by dt_mirror_alloc()
+ */
+void dt_mirror_free(void *ptr, size_t size);
+
+/*
+ * Allocation tracking
+ *
+ * Off by default, switched on by DT_MEM_TRACK=1 in the environment or
+ * dt_mem_track_enable() before the first dt_ allocation, and stays on
+ * once enabled. Tracked blocks carry
+ * a header with size and call site, every call site keeps atomic counters.
+ * When off, the only cost is one predicted branch per call.
+ */
+typedef struct {
+    int64_t live;       // bytes allocated and not freed
+    int64_t peak;       // highest live
+    int64_t count;      // allocations
+} dt_mem_stat_t;
+
+typedef struct dt_mem_site {
+    const char *file;
+    int line;
+    int registered;
+    struct dt_mem_site *next;
+    dt_mem_stat_t stat;
+} dt_mem_site_t;
+
+void *dt_malloc_site(size_t size, dt_mem_site_t *site);
+void *dt_mallocz_site(size_t size, dt_mem_site_t *site);
+void *dt_calloc_site(size_t nmemb, size_t size, dt_mem_site_t *site);
+void *dt_realloc_site(void *ptr, size_t size, dt_mem_site_t *site);
+char *dt_strdup_site(const char *s, dt_mem_site_t *site);
+char *dt_strndup_site(const char *s, size_t len, dt_mem_site_t *site);
+void *dt_memdup_site(const void *p, size_t size, dt_mem_site_t *site);
+
+/* *
+ * Enable tracking, call before any dt_ allocation and before other threads
+ * start; blocks without a tracking header can not be told apart later
+ *
+ * @return 0 for success, -1 if memory was already allocated untracked
+ *
+ */
+int dt_mem_track_enable(void);
+int dt_mem_track_enabled(void);
+
+/* *
+ * Totals over all call sites
+ */
+void dt_mem_track_total(dt_mem_stat_t *stat);
+
+/* *
+ * Log every call site, leaks_only: sites with live bytes only
+ */
+void dt_mem_track_dump(int leaks_only);
+
+/* call sites are recorded as file:line on compilers with statement expressions */
+#if defined(__GNUC__) && !defined(DT_MEM_NO_SITE)
+#define DT_MEM_SITE() \
+    ({ static dt_mem_site_t dt_mem_site_ = { .file = __FILE__, .line = __LINE__ }; &dt_mem_site_; })
+
+#define dt_malloc(size)             dt_malloc_site(size, DT_MEM_SITE())
+#define dt_mallocz(size)            dt_mallocz_site(size, DT_MEM_SITE())
+#define dt_calloc(nmemb, size)      dt_calloc_site(nmemb, size, DT_MEM_SITE())
+#define dt_realloc(ptr, size)       dt_realloc_site(ptr, size, DT_MEM_SITE())
+#define dt_strdup(s)                dt_strdup_site(s, DT_MEM_SITE())
+#define dt_strndup(s, len)          dt_strndup_site(s, len, DT_MEM_SITE())
+#define dt_memdup(p, size)          dt_memdup_site(p, size, DT_MEM_SITE())
+#endif
+
+#endif
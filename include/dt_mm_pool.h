@@ -20,10 +20,59 @@
 
 struct dt_mm_pool;
 
+/*
+ * default mode: first-fit over one free list
+ * every free merges with both physical neighbours (inline boundary tags)
+ * dt_mm_pool_dump reports largest free block vs total free
+ *
+ * DT_MM_POOL_SIZE_CLASS
+ * two-level segregated fit: free blocks binned by size class, bins found
+ * through bitmaps, block headers kept inline, O(1) alloc & free
+ * returned memory is 16 bytes aligned
+ */
+#define DT_MM_POOL_SIZE_CLASS 0x1
+
+/*
+ * DT_MM_POOL_THREAD_CACHE
+ * each thread keeps freed blocks of up to 4MB, about 1MB per size class
+ * (16 blocks at most, 2 at least), and refills / flushes them in batches,
+ * most alloc & free skip the pool mutex
+ * cached blocks count as used in dt_mm_pool_dump
+ */
+#define DT_MM_POOL_THREAD_CACHE 0x2
+
+/*
+ * pool memory backing, default is one malloc
+ * DT_MM_POOL_MMAP       anonymous mmap, size rounded up to page size
+ * DT_MM_POOL_HUGEPAGE   mmap + madvise(MADV_HUGEPAGE), transparent huge pages
+ * DT_MM_POOL_HUGETLB    mmap(MAP_HUGETLB) from the hugetlbfs reserve, size
+ *                       rounded to 2MB, falls back to HUGEPAGE if none left
+ * DT_MM_POOL_POPULATE   pre-fault every page at create
+ * DT_MM_POOL_NUMA_NODE  bind pages to NUMA node n with mbind (MPOL_BIND)
+ * any of them implies DT_MM_POOL_MMAP
+ */
+#define DT_MM_POOL_MMAP         0x4
+#define DT_MM_POOL_HUGEPAGE     0x8
+#define DT_MM_POOL_HUGETLB      0x10
+#define DT_MM_POOL_POPULATE     0x20
+#define DT_MM_POOL_NUMA         0x40
+#define DT_MM_POOL_NUMA_NODE(n) (DT_MM_POOL_NUMA | (((n) & 0xff) << 16))
+
+struct dt_mm_pool_stat {
+    int64_t size;           // arena bytes, block headers included
+    int64_t use_size;
+    int64_t free_size;
+    int64_t largest_free;
+    int use_count;
+    int free_count;
+};
+
 struct dt_mm_pool *dt_mm_pool_create(int64_t size);
+struct dt_mm_pool *dt_mm_pool_create2(int64_t size, int flags);
 uint8_t *dt_mm_pool_alloc(struct dt_mm_pool *pool, int size);
 int dt_mm_pool_free(struct dt_mm_pool *pool, uint8_t *ptr);
 void dt_mm_pool_destroy(struct dt_mm_pool *pool);
 void dt_mm_pool_dump(struct dt_mm_pool *pool);
+int dt_mm_pool_get_stat(struct dt_mm_pool *pool, struct dt_mm_pool_stat *stat);
 
 #endif
@@ -0,0 +1,76 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_mpmc.h
+ *    Description:  bounded multi-producer/multi-consumer queue
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s (), peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+/*
+ * Array based lock-free queue with one sequence number per slot
+ * (D. Vyukov bounded MPMC design). Capacity is fixed at creation
+ * and rounded up to a power of two.
+ */
+
+#ifndef DT_MPMC_H
+#define DT_MPMC_H
+
+#include <stdint.h>
+
+typedef struct dt_mpmc_queue dt_mpmc_queue_t;
+
+/* *
+ * Create queue
+ *
+ * @param capacity max element count, rounded up to power of two
+ *
+ * @return queue pointer for success, NULL otherwise
+ *
+ */
+dt_mpmc_queue_t *dt_mpmc_queue_new(uint32_t capacity);
+
+/* *
+ * Release queue, elements still queued are not freed
+ */
+void dt_mpmc_queue_free(dt_mpmc_queue_t *q);
+
+uint32_t dt_mpmc_queue_capacity(dt_mpmc_queue_t *q);
+
+/* *
+ * Approximate element count, exact only when queue is quiescent
+ */
+uint32_t dt_mpmc_queue_length(dt_mpmc_queue_t *q);
+
+/* *
+ * Non-blocking push/pop
+ *
+ * @return 0 for success, -1 if queue full (push) or empty (pop)
+ *
+ */
+int dt_mpmc_try_push(dt_mpmc_queue_t *q, void *data);
+int dt_mpmc_try_pop(dt_mpmc_queue_t *q, void **data);
+
+/* *
+ * Blocking push/pop, spin then yield until success
+ */
+void dt_mpmc_push(dt_mpmc_queue_t *q, void *data);
+void *dt_mpmc_pop(dt_mpmc_queue_t *q);
+
+/* *
+ * Non-blocking batch push/pop
+ * claim up to n consecutive slots with a single cas
+ *
+ * @return number of elements pushed/popped, 0 if full/empty
+ *
+ */
+int dt_mpmc_try_push_n(dt_mpmc_queue_t *q, void **data, int n);
+int dt_mpmc_try_pop_n(dt_mpmc_queue_t *q, void **data, int n);
+
+#endif
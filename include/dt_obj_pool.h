@@ -0,0 +1,78 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_obj_pool.h
+ *    Description:  fixed-size object pool
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s (), peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+/*
+ * Objects of one size carved from chunks, free objects are linked
+ * through their first 4 bytes (intrusive freelist), get/put are O(1).
+ * Chunks are never released before dt_obj_pool_destroy.
+ */
+
+#ifndef DT_OBJ_POOL_H
+#define DT_OBJ_POOL_H
+
+#include <stdint.h>
+
+#include "dt_mm_pool.h"
+
+/* add a chunk when empty, chunk k holds count << k objects */
+#define DT_OBJ_POOL_GROW      0x1
+/* get/put through a tagged cas on the freelist head, no mutex */
+#define DT_OBJ_POOL_LOCKFREE  0x2
+
+typedef struct dt_obj_pool dt_obj_pool_t;
+
+/* *
+ * Create object pool
+ *
+ * @param size  object size in bytes
+ * @param align object alignment, power of two, 0 for pointer alignment
+ * @param count objects in first chunk
+ * @param flags DT_OBJ_POOL_*
+ *
+ * @return pool pointer for success, NULL otherwise
+ *
+ */
+dt_obj_pool_t *dt_obj_pool_create(int size, int align, int count, int flags);
+
+/* *
+ * Create object pool with chunks taken from a dt_mm_pool
+ * mm must outlive the object pool
+ */
+dt_obj_pool_t *dt_obj_pool_create2(struct dt_mm_pool *mm, int size, int align, int count, int flags);
+
+/* *
+ * Get an object, content undefined
+ *
+ * @return object pointer, NULL if pool empty and can not grow
+ *
+ */
+void *dt_obj_pool_get(dt_obj_pool_t *pool);
+
+/* *
+ * Put object back
+ *
+ * @return 0 for success, -1 if obj not from this pool
+ *
+ */
+int dt_obj_pool_put(dt_obj_pool_t *pool, void *obj);
+
+/* *
+ * Objects owned by pool, free and in use
+ */
+int dt_obj_pool_capacity(dt_obj_pool_t *pool);
+
+void dt_obj_pool_destroy(dt_obj_pool_t *pool);
+
+#endif
@@ -39,23 +39,62 @@ typedef struct {
     _node_t *tail;
     uint32_t length;
     pthread_mutex_t mutex;
-    pthread_cond_t cond;
+    pthread_cond_t cond;        // signalled when data pushed
+    pthread_cond_t cond_space;  // signalled when data popped
+    uint32_t max_length;        // 0: unbounded
+    int waiters;
+    int space_waiters;
+
+    /* node cache, recycled nodes linked by next */
+    _node_t *free_nodes;
+    uint32_t free_count;
+    uint32_t free_max;          // high-water mark of cached nodes
+    uint64_t node_alloc;        // nodes from malloc
+    uint64_t node_reuse;        // nodes from cache
 } dt_queue_t;
 
+#define DT_QUEUE_NODE_CACHE_DEFAULT 256
+
+typedef struct {
+    uint64_t node_alloc;
+    uint64_t node_reuse;
+    uint32_t node_cached;
+} dt_queue_stats_t;
+
 dt_queue_t *dt_queue_new(void);
 
 typedef void (*free_func)(void *);
 void dt_queue_free(dt_queue_t * qu, free_func func);
 void dt_queue_flush(dt_queue_t * qu, free_func func);
 
+/*
+ * Blocking ops, timeout unit : millisecond, timeout <= 0 waits forever
+ * wait_on_* return 0 once queue is not empty, -1 on timeout
+ */
 int wait_on_queue(dt_queue_t * qu);
 int wait_on_dt_queue_timeout(dt_queue_t * qu, int timeout);
 
+/* capacity for dt_queue_push_tail_timeout, 0 means unbounded */
+void dt_queue_set_max_length(dt_queue_t * qu, uint32_t max_length);
+/* block while queue holds max_length nodes, return 0 or -1 on timeout */
+int dt_queue_push_tail_timeout(dt_queue_t * qu, void *data, int timeout);
+/* block while queue is empty, return NULL on timeout */
+void *dt_queue_pop_head_timeout(dt_queue_t * qu, int timeout);
+
 uint32_t dt_queue_length(dt_queue_t * qu);
 
+/* keep at most max freed nodes for reuse, 0 disables the node cache */
+void dt_queue_set_node_cache(dt_queue_t * qu, uint32_t max);
+void dt_queue_get_stats(dt_queue_t * qu, dt_queue_stats_t * stats);
+
 void dt_queue_push_head(dt_queue_t * qu, void *data);
 void dt_queue_push_tail(dt_queue_t * qu, void *data);
 void dt_queue_push_nth(dt_queue_t * qu, void *data, uint32_t n);
+/* batch ops, one lock for the whole array, return data count moved */
+int dt_queue_push_tail_n(dt_queue_t * qu, void **data, int n);
+int dt_queue_pop_head_n(dt_queue_t * qu, void **data, int n);
+/* move all of src to tail of dst in O(1) */
+uint32_t dt_queue_splice_tail(dt_queue_t * dst, dt_queue_t * src);
 
 void *dt_queue_pop_head(dt_queue_t * qu);
 void *dt_queue_pre_pop_head(dt_queue_t * qu);
@@ -8,6 +8,12 @@
  */
 int64_t dt_gettime(void);
 
+/**
+ * Get a monotonic time in microseconds, unaffected by wall clock changes.
+ * Only differences between two values are meaningful.
+ */
+int64_t dt_gettime_relative(void);
+
 /**
  * Sleep for a period of time.  Although the duration is expressed in
  * microseconds, the actual delay may be rounded to the precision of the
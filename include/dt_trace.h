@@ -0,0 +1,88 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_trace.h
+ *    Description:  binary deferred-format trace log
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s (), peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+/*
+ * DT_TRACE records a format id, a timestamp and the raw arguments into a
+ * memory-mapped ring file, no printf runs on the caller's thread. Format
+ * strings are stored once per call site in the file, dt_trace_decode (or
+ * the dt_trace_decode tool) renders the text offline.
+ *
+ * The ring keeps the most recent records, older blocks are overwritten.
+ * Supported conversions: d i u o x X c e f g a E F G A p s with the usual
+ * flags, width and precision; length modifiers hh h l ll L q z j t on
+ * integers, L on floating point. '*' width/precision, %n and wide %ls / %lc
+ * are not supported, sites using them are dropped. Strings are copied into the
+ * record, cut at DT_TRACE_STR_MAX bytes. Arguments take 8 byte slots, so
+ * long double (%Lf ...) is narrowed to double and loses precision and range.
+ */
+
+#ifndef DT_TRACE_H
+#define DT_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define DT_TRACE_MAX_ARGS 16
+#define DT_TRACE_STR_MAX  255
+
+typedef struct dt_trace_site {
+    const char *tag;
+    const char *fmt;
+    const char *file;
+    int line;
+    int gen;                // trace file the id belongs to
+    int id;                 // format id, -1: site rejected
+    int nargs;
+    uint8_t kind[DT_TRACE_MAX_ARGS];
+} dt_trace_site_t;
+
+extern int dt_trace_on;
+
+#define DT_TRACE(tag_, fmt_, ...) do { \
+    static dt_trace_site_t dt_trace_site_ = { .tag = tag_, .fmt = fmt_, .file = __FILE__, .line = __LINE__ }; \
+    if (__builtin_expect(dt_trace_on, 0)) { \
+        dt_trace_write(&dt_trace_site_, ##__VA_ARGS__); \
+    } \
+} while (0)
+
+/* *
+ * Create trace file and start recording
+ *
+ * @param path trace file, truncated
+ * @param size ring bytes, rounded up to whole blocks (64KB)
+ *
+ * @return 0 for success, -1 otherwise
+ *
+ */
+int dt_trace_open(const char *path, size_t size);
+
+/* *
+ * Stop recording and unmap the file
+ * no thread may be inside DT_TRACE while closing
+ */
+void dt_trace_close(void);
+
+/* DT_TRACE backend, not called directly */
+void dt_trace_write(dt_trace_site_t *site, ...);
+
+/* *
+ * Render a trace file as text, oldest record first
+ *
+ * @return records rendered, -1 if path is not a trace file
+ *
+ */
+int dt_trace_decode(const char *path, FILE *out);
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_arena.c
+ *    Description:  region allocator for short-lived scratch memory
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "dt_arena.h"
+#include "dt_macro.h"
+#include "dt_mem.h"
+
+#define CHUNK_HDR_SIZE ((sizeof(struct arena_chunk) + DT_ARENA_ALIGN - 1) & ~(size_t)(DT_ARENA_ALIGN - 1))
+
+struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;            // data bytes
+    size_t used;
+};
+
+struct dt_arena {
+    struct arena_chunk *head;
+    struct arena_chunk *cur;
+    size_t chunk_size;
+    size_t total;           // data bytes in all chunks
+};
+
+static inline uint8_t *chunk_data(struct arena_chunk *chunk)
+{
+    return (uint8_t *)chunk + CHUNK_HDR_SIZE;
+}
+
+static struct arena_chunk *chunk_new(size_t size)
+{
+    struct arena_chunk *chunk = (struct arena_chunk *)dt_malloc(CHUNK_HDR_SIZE + size);
+    if (chunk) {
+        chunk->next = NULL;
+        chunk->size = size;
+        chunk->used = 0;
+    }
+    return chunk;
+}
+
+dt_arena_t *dt_arena_create(size_t chunk_size)
+{
+    dt_arena_t *arena = (dt_arena_t *)dt_mallocz(sizeof(dt_arena_t));
+    if (!arena) {
+        return NULL;
+    }
+    arena->chunk_size = chunk_size ? chunk_size : 4096;
+    arena->head = arena->cur = chunk_new(arena->chunk_size);
+    if (!arena->head) {
+        dt_free(arena);
+        return NULL;
+    }
+    arena->total = arena->chunk_size;
+    return arena;
+}
+
+void dt_arena_destroy(dt_arena_t *arena)
+{
+    struct arena_chunk *chunk, *next;
+    if (!arena) {
+        return;
+    }
+    for (chunk = arena->head; chunk; chunk = next) {
+        next = chunk->next;
+        dt_free(chunk);
+    }
+    dt_free(arena);
+}
+
+/* offset in chunk where an aligned block of size fits, -1 if not */
+static inline intptr_t chunk_fit(struct arena_chunk *chunk, size_t size, size_t align)
+{
+    uintptr_t base = (uintptr_t)chunk_data(chunk);
+    size_t off = ((base + chunk->used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+    return off + size <= chunk->size ? (intptr_t)off : -1;
+}
+
+void *dt_arena_alloc_align(dt_arena_t *arena, size_t size, size_t align)
+{
+    struct arena_chunk *chunk = arena->cur;
+    intptr_t off;
+
+    if (align < DT_ARENA_ALIGN) {
+        align = DT_ARENA_ALIGN;
+    }
+    if (size > INT_MAX) {
+        return NULL;
+    }
+    // chunks after cur are unused: move the first big enough one behind
+    // cur, allocate a new chunk only if none is left
+    while ((off = chunk_fit(chunk, size, align)) < 0) {
+        struct arena_chunk **pp = &chunk->next;
+        struct arena_chunk *next;
+        while (*pp && (*pp)->size < size + align) {
+            pp = &(*pp)->next;
+        }
+        next = *pp;
+        if (next) {
+            *pp = next->next;
+        } else {
+            next = chunk_new(DT_MAX(arena->chunk_size, size + align));
+            if (!next) {
+                return NULL;
+            }
+            arena->total += next->size;
+        }
+        next->next = chunk->next;
+        chunk->next = next;
+        next->used = 0;
+        chunk = next;
+    }
+    arena->cur = chunk;
+    chunk->used = off + size;
+    return chunk_data(chunk) + off;
+}
+
+void *dt_arena_alloc(dt_arena_t *arena, size_t size)
+{
+    return dt_arena_alloc_align(arena, size, DT_ARENA_ALIGN);
+}
+
+void *dt_arena_mallocz(dt_arena_t *arena, size_t size)
+{
+    void *ptr = dt_arena_alloc(arena, size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+void *dt_arena_realloc(dt_arena_t *arena, void *ptr, size_t old_size, size_t size)
+{
+    struct arena_chunk *chunk = arena->cur;
+    uint8_t *p = (uint8_t *)ptr;
+    void *ret;
+
+    if (!p) {
+        return dt_arena_alloc(arena, size);
+    }
+    // last block of the current chunk: move the bump pointer only
+    if (p + old_size == chunk_data(chunk) + chunk->used &&
+        (size_t)(p - chunk_data(chunk)) + size <= chunk->size) {
+        chunk->used = (size_t)(p - chunk_data(chunk)) + size;
+        return p;
+    }
+    if (size <= old_size) {
+        return p;
+    }
+    ret = dt_arena_alloc(arena, size);
+    if (ret) {
+        memcpy(ret, p, old_size);
+    }
+    return ret;
+}
+
+void dt_arena_reset(dt_arena_t *arena)
+{
+    arena->cur = arena->head;
+    arena->head->used = 0;
+}
+
+dt_arena_mark_t dt_arena_mark(dt_arena_t *arena)
+{
+    dt_arena_mark_t mark;
+    mark.chunk = arena->cur;
+    mark.used = arena->cur->used;
+    return mark;
+}
+
+void dt_arena_rollback(dt_arena_t *arena, dt_arena_mark_t mark)
+{
+    arena->cur = (struct arena_chunk *)mark.chunk;
+    arena->cur->used = mark.used;
+}
+
+size_t dt_arena_used(dt_arena_t *arena)
+{
+    struct arena_chunk *chunk;
+    size_t used = 0;
+    for (chunk = arena->head; chunk != arena->cur; chunk = chunk->next) {
+        used += chunk->used;
+    }
+    return used + arena->cur->used;
+}
+
+size_t dt_arena_size(dt_arena_t *arena)
+{
+    return arena->total;
+}
+
+char *dt_arena_strdup(dt_arena_t *arena, const char *s)
+{
+    return s ? (char *)dt_arena_memdup(arena, s, strlen(s) + 1) : NULL;
+}
+
+char *dt_arena_strndup(dt_arena_t *arena, const char *s, size_t len)
+{
+    char *ret, *end;
+
+    if (!s) {
+        return NULL;
+    }
+    end = memchr(s, 0, len);
+    if (end) {
+        len = end - s;
+    }
+    ret = (char *)dt_arena_alloc(arena, len + 1);
+    if (!ret) {
+        return NULL;
+    }
+    memcpy(ret, s, len);
+    ret[len] = 0;
+    return ret;
+}
+
+void *dt_arena_memdup(dt_arena_t *arena, const void *p, size_t size)
+{
+    void *ptr = NULL;
+    if (p) {
+        ptr = dt_arena_alloc(arena, size);
+        if (ptr) {
+            memcpy(ptr, p, size);
+        }
+    }
+    return ptr;
+}
+
+void *dt_arena_dynarray2_add(dt_arena_t *arena, void **tab_ptr, int *nb_ptr,
+                             size_t elem_size, const uint8_t *elem_data)
+{
+    uint8_t *tab_elem_data;
+    int nb = *nb_ptr;
+
+    // same growth points as DT_DYNARRAY_ADD: capacity doubles at powers of 2
+    if (!(nb & (nb - 1))) {
+        size_t nb_new = nb ? (size_t)nb << 1 : 1;
+        void *tab;
+        if (nb_new > INT_MAX / elem_size) {
+            return NULL;
+        }
+        tab = dt_arena_realloc(arena, *tab_ptr, nb * elem_size, nb_new * elem_size);
+        if (!tab) {
+            return NULL;
+        }
+        *tab_ptr = tab;
+    }
+    tab_elem_data = (uint8_t *)*tab_ptr + nb * elem_size;
+    if (elem_data) {
+        memcpy(tab_elem_data, elem_data, elem_size);
+    }
+    (*nb_ptr)++;
+    return tab_elem_data;
+}
@@ -1,4 +1,5 @@
 #include "dt_buffer.h"
+#include "dt_mem.h"
 #include "dt_log.h"
 
 #include "stdlib.h"
@@ -10,7 +11,28 @@
 
 int dtbuf_init(dt_buffer_t * dbt, int size)
 {
-    uint8_t *buffer = (uint8_t *) malloc(size);
+    return dtbuf_init2(dbt, size, 0);
+}
+
+int dtbuf_init2(dt_buffer_t * dbt, int size, int flags)
+{
+    // spsc positions wrap at 2 * size
+    if (size <= 0 || size > INT32_MAX / 2) {
+        dbt->data = NULL;
+        return -1;
+    }
+    uint8_t *buffer;
+    if (flags & DTBUF_FLAG_MIRROR) {
+        size_t len = size;
+        buffer = (uint8_t *) dt_mirror_alloc(&len);
+        if (buffer && len > INT32_MAX / 2) {
+            dt_mirror_free(buffer, len);
+            buffer = NULL;
+        }
+        size = (int)len;
+    } else {
+        buffer = (uint8_t *) malloc(size);
+    }
     if (!buffer) {
         dbt->data = NULL;
         return -1;
@@ -18,17 +40,24 @@ int dtbuf_init(dt_buffer_t * dbt, int size)
     dbt->data = buffer;
     dbt->size = size;
     dbt->level = 0;
+    dbt->flags = flags;
     dbt->rd_ptr = dbt->wr_ptr = dbt->data;
+    dbt->rd_pos = dbt->wr_pos = 0;
     dt_lock_init(&dbt->mutex, NULL);
-    dt_info(TAG, "DTBUF INIT OK\n");
+    dt_info(TAG, "DTBUF INIT OK, flags:%x\n", flags);
     return 0;
 }
 
+/*
+ * spsc mode: caller guarantees no put/get running concurrently
+ */
 int dtbuf_reinit(dt_buffer_t * dbt)
 {
     dt_lock(&dbt->mutex);
     dbt->level = 0;
     dbt->rd_ptr = dbt->wr_ptr = dbt->data;
+    dt_atomic_store_release(&dbt->rd_pos, 0);
+    dt_atomic_store_release(&dbt->wr_pos, 0);
     dt_unlock(&dbt->mutex);
     return 0;
 }
@@ -37,7 +66,12 @@ int dtbuf_release(dt_buffer_t * dbt)
 {
     dt_lock(&dbt->mutex);
     if (dbt->data) {
-        free(dbt->data);
+        if (dbt->flags & DTBUF_FLAG_MIRROR) {
+            dt_mirror_free(dbt->data, dbt->size);
+        } else {
+            free(dbt->data);
+        }
+        dbt->data = NULL;
     }
     dbt->size = 0;
     dt_unlock(&dbt->mutex);
@@ -68,20 +102,106 @@ static int dtbuf_full(dt_buffer_t * dbt)
     return ret;
 }
 
+/*
+ * spsc helpers
+ * rd_pos/wr_pos run in [0, 2 * size) so that full (distance == size)
+ * and empty (distance == 0) can be told apart without a shared level
+ */
+static inline int spsc_distance(dt_buffer_t * dbt, uint32_t rd, uint32_t wr)
+{
+    return (int)(wr >= rd ? wr - rd : wr + 2 * dbt->size - rd);
+}
+
+static inline uint32_t spsc_advance(dt_buffer_t * dbt, uint32_t pos, int len)
+{
+    pos += len;
+    if (pos >= (uint32_t)(2 * dbt->size)) {
+        pos -= 2 * dbt->size;
+    }
+    return pos;
+}
+
+static inline int spsc_offset(dt_buffer_t * dbt, uint32_t pos)
+{
+    return (int)(pos >= (uint32_t)dbt->size ? pos - dbt->size : pos);
+}
+
+static int spsc_level(dt_buffer_t * dbt)
+{
+    uint32_t rd = dt_atomic_load_acquire(&dbt->rd_pos);
+    uint32_t wr = dt_atomic_load_acquire(&dbt->wr_pos);
+    return spsc_distance(dbt, rd, wr);
+}
+
+static int dtbuf_get_spsc(dt_buffer_t * dbt, uint8_t * out, int size)
+{
+    // rd_pos only written by this side
+    uint32_t rd = dt_atomic_load(&dbt->rd_pos);
+    uint32_t wr = dt_atomic_load_acquire(&dbt->wr_pos);
+    int len = DT_MIN(spsc_distance(dbt, rd, wr), size);
+    if (len <= 0) {
+        return 0;
+    }
+
+    int off = spsc_offset(dbt, rd);
+    int tail_len = dbt->size - off;
+    if (len <= tail_len || (dbt->flags & DTBUF_FLAG_MIRROR)) {
+        memcpy(out, dbt->data + off, len);
+    } else {
+        memcpy(out, dbt->data + off, tail_len);
+        memcpy(out + tail_len, dbt->data, len - tail_len);
+    }
+    // release: copy-out done before producer may reuse the space
+    dt_atomic_store_release(&dbt->rd_pos, spsc_advance(dbt, rd, len));
+    return len;
+}
+
+static int dtbuf_put_spsc(dt_buffer_t * dbt, uint8_t * in, int size)
+{
+    // wr_pos only written by this side
+    uint32_t wr = dt_atomic_load(&dbt->wr_pos);
+    uint32_t rd = dt_atomic_load_acquire(&dbt->rd_pos);
+    int len = DT_MIN(dbt->size - spsc_distance(dbt, rd, wr), size);
+    if (len <= 0) {
+        return 0;
+    }
+
+    int off = spsc_offset(dbt, wr);
+    int tail_len = dbt->size - off;
+    if (len <= tail_len || (dbt->flags & DTBUF_FLAG_MIRROR)) {
+        memcpy(dbt->data + off, in, len);
+    } else {
+        memcpy(dbt->data + off, in, tail_len);
+        memcpy(dbt->data, in + tail_len, len - tail_len);
+    }
+    // release: data visible before consumer sees new wr_pos
+    dt_atomic_store_release(&dbt->wr_pos, spsc_advance(dbt, wr, len));
+    return len;
+}
+
 int dtbuf_space(dt_buffer_t * dbt)
 {
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        return dbt->size - spsc_level(dbt);
+    }
     int space = dbt->size - dbt->level;
     return space;
 }
 
 int dtbuf_level(dt_buffer_t * dbt)
 {
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        return spsc_level(dbt);
+    }
     int lev = dbt->level;
     return lev;
 }
 
 int dtbuf_get(dt_buffer_t * dbt, uint8_t * out, int size)
 {
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        return dtbuf_get_spsc(dbt, out, size);
+    }
     dt_lock(&dbt->mutex);
     int len = -1;
     len = dtbuf_empty(dbt);
@@ -91,7 +211,16 @@ int dtbuf_get(dt_buffer_t * dbt, uint8_t * out, int size)
     }
 
     len = DT_MIN(dbt->level, size);
-    if (dbt->wr_ptr > dbt->rd_ptr) {
+    if (dbt->flags & DTBUF_FLAG_MIRROR) {
+        memcpy(out, dbt->rd_ptr, len);
+        dbt->rd_ptr += len;
+        if (dbt->rd_ptr >= dbt->data + dbt->size) {
+            dbt->rd_ptr -= dbt->size;
+        }
+        dbt->level -= len;
+        goto QUIT;
+
+    } else if (dbt->wr_ptr > dbt->rd_ptr) {
         memcpy(out, dbt->rd_ptr, len);
         dbt->rd_ptr += len;
         dbt->level -= len;
@@ -118,6 +247,9 @@ QUIT:
 
 int dtbuf_put(dt_buffer_t * dbt, uint8_t * in, int size)
 {
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        return dtbuf_put_spsc(dbt, in, size);
+    }
     dt_lock(&dbt->mutex);
     int len = dtbuf_full(dbt);
     if (len == 1) {
@@ -126,7 +258,16 @@ int dtbuf_put(dt_buffer_t * dbt, uint8_t * in, int size)
     }
 
     len = DT_MIN(dbt->size - dbt->level, size);
-    if (dbt->wr_ptr < dbt->rd_ptr) {
+    if (dbt->flags & DTBUF_FLAG_MIRROR) {
+        memcpy(dbt->wr_ptr, in, len);
+        dbt->wr_ptr += len;
+        if (dbt->wr_ptr >= dbt->data + dbt->size) {
+            dbt->wr_ptr -= dbt->size;
+        }
+        dbt->level += len;
+        goto QUIT;
+
+    } else if (dbt->wr_ptr < dbt->rd_ptr) {
         memcpy(dbt->wr_ptr, in, len);
         dbt->wr_ptr += len;
         dbt->level += len;
@@ -150,3 +291,110 @@ QUIT:
     dt_unlock(&dbt->mutex);
     return len;
 }
+
+/*
+ * zero-copy ops
+ * describe [off, off + len) of the ring as at most two contiguous spans
+ */
+static int fill_span(dt_buffer_t * dbt, dtbuf_span_t * span, int off, int len)
+{
+    if (off >= dbt->size) {
+        off -= dbt->size;
+    }
+    if (len < 0) {
+        len = 0;
+    }
+    span->ptr[0] = dbt->data + off;
+    span->len[0] = (dbt->flags & DTBUF_FLAG_MIRROR) ? len : DT_MIN(len, dbt->size - off);
+    span->ptr[1] = dbt->data;
+    span->len[1] = len - span->len[0];
+    return len;
+}
+
+int dtbuf_reserve(dt_buffer_t * dbt, dtbuf_span_t * span, int size)
+{
+    int off, len;
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        uint32_t wr = dt_atomic_load(&dbt->wr_pos);
+        uint32_t rd = dt_atomic_load_acquire(&dbt->rd_pos);
+        off = spsc_offset(dbt, wr);
+        len = dbt->size - spsc_distance(dbt, rd, wr);
+    } else {
+        dt_lock(&dbt->mutex);
+        off = (int)(dbt->wr_ptr - dbt->data);
+        len = dbt->size - dbt->level;
+        dt_unlock(&dbt->mutex);
+    }
+    return fill_span(dbt, span, off, DT_MIN(len, size));
+}
+
+int dtbuf_commit(dt_buffer_t * dbt, int size)
+{
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        uint32_t wr = dt_atomic_load(&dbt->wr_pos);
+        uint32_t rd = dt_atomic_load_acquire(&dbt->rd_pos);
+        if (size < 0 || size > dbt->size - spsc_distance(dbt, rd, wr)) {
+            return -1;
+        }
+        dt_atomic_store_release(&dbt->wr_pos, spsc_advance(dbt, wr, size));
+        return 0;
+    }
+
+    dt_lock(&dbt->mutex);
+    if (size < 0 || size > dbt->size - dbt->level) {
+        dt_unlock(&dbt->mutex);
+        return -1;
+    }
+    int off = (int)(dbt->wr_ptr - dbt->data) + size;
+    if (off >= dbt->size) {
+        off -= dbt->size;
+    }
+    dbt->wr_ptr = dbt->data + off;
+    dbt->level += size;
+    dt_unlock(&dbt->mutex);
+    return 0;
+}
+
+int dtbuf_peek(dt_buffer_t * dbt, dtbuf_span_t * span, int size)
+{
+    int off, len;
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        uint32_t rd = dt_atomic_load(&dbt->rd_pos);
+        uint32_t wr = dt_atomic_load_acquire(&dbt->wr_pos);
+        off = spsc_offset(dbt, rd);
+        len = spsc_distance(dbt, rd, wr);
+    } else {
+        dt_lock(&dbt->mutex);
+        off = (int)(dbt->rd_ptr - dbt->data);
+        len = dbt->level;
+        dt_unlock(&dbt->mutex);
+    }
+    return fill_span(dbt, span, off, DT_MIN(len, size));
+}
+
+int dtbuf_consume(dt_buffer_t * dbt, int size)
+{
+    if (dbt->flags & DTBUF_FLAG_SPSC) {
+        uint32_t rd = dt_atomic_load(&dbt->rd_pos);
+        uint32_t wr = dt_atomic_load_acquire(&dbt->wr_pos);
+        if (size < 0 || size > spsc_distance(dbt, rd, wr)) {
+            return -1;
+        }
+        dt_atomic_store_release(&dbt->rd_pos, spsc_advance(dbt, rd, size));
+        return 0;
+    }
+
+    dt_lock(&dbt->mutex);
+    if (size < 0 || size > dbt->level) {
+        dt_unlock(&dbt->mutex);
+        return -1;
+    }
+    int off = (int)(dbt->rd_ptr - dbt->data) + size;
+    if (off >= dbt->size) {
+        off -= dbt->size;
+    }
+    dbt->rd_ptr = dbt->data + off;
+    dbt->level -= size;
+    dt_unlock(&dbt->mutex);
+    return 0;
+}
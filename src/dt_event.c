@@ -27,6 +27,28 @@
 
  event_transport_loop
  get event form main-server, transport to dest service
+ sleep on main-server event_cond while main-server is empty
+
+ direct mode (DT_EVENT_FLAG_DIRECT)
+ senders push into the destination's inbox with one cas, receivers
+ take the whole inbox with one exchange under event_lock, reverse it and
+ append it to the lanes. waiters is announced before the receiver checks
+ the inbox and read by senders after the push, so no wakeup is lost.
+
+ priority lanes
+ each server queues events in one FIFO lane per priority, receivers
+ always get the highest pending lane first. With coalesce enabled an
+ event whose type is already pending in its lane just updates that arg.
+
+ event pool
+ receivers hand events back with dt_release_event, each thread keeps
+ a small cache of them, overflow goes to a global list in batches.
+
+ route
+ id -> server open addressing hash, immutable once published.
+ register/remove build a new table under server_lock, publish it,
+ then wait for readers of the previous epoch before freeing the old
+ table (and removed server). Senders never take server_lock.
 
 */
 
@@ -46,6 +68,7 @@
  *
  * 4 query or get event and handle
  * event_t *event_tmp = dt_get_event(server);
+ * dt_release_event(event_tmp);
  *
  * 5 remove user server
  * dt_remove_server(mgt, server);
@@ -63,8 +86,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
+#include <sched.h>
 
+#include "dt_atomic.h"
 #include "dt_event.h"
+#include "dt_macro.h"
 #include "dt_mem.h"
 #include "dt_log.h"
 
@@ -77,8 +104,432 @@ static event_server_t main_server;
 /* private func */
 static void *event_transport_loop();
 static int dt_transport_event(event_t * event, dt_server_mgt_t * mgt);
+static void server_free(event_server_t * server);
+
+/*
+ * event pool
+ * pooled events are plain malloc blocks, free() on them stays valid
+ */
+#define EVENT_CACHE_SIZE 64
+#define EVENT_POOL_MAX   4096
+
+typedef struct {
+    event_t *event[EVENT_CACHE_SIZE];
+    int count;
+    int registered;
+} event_cache_t;
+
+static __thread event_cache_t event_cache;
+static pthread_key_t event_cache_key;
+static pthread_once_t event_cache_once = PTHREAD_ONCE_INIT;
+static dt_lock_t event_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static event_t *event_pool;
+static int event_pool_count;
+
+/* move cached events down to keep into the global list */
+static void event_cache_flush(event_cache_t *cache, int keep)
+{
+    dt_lock(&event_pool_lock);
+    while (cache->count > keep) {
+        event_t *event = cache->event[--cache->count];
+        if (event_pool_count >= EVENT_POOL_MAX) {
+            free(event);
+            continue;
+        }
+        event->next = event_pool;
+        event_pool = event;
+        event_pool_count++;
+    }
+    dt_unlock(&event_pool_lock);
+}
+
+static void event_cache_refill(event_cache_t *cache)
+{
+    dt_lock(&event_pool_lock);
+    while (cache->count < EVENT_CACHE_SIZE / 2 && event_pool) {
+        cache->event[cache->count++] = event_pool;
+        event_pool = event_pool->next;
+        event_pool_count--;
+    }
+    dt_unlock(&event_pool_lock);
+}
+
+/* thread exit: hand cached events to other threads */
+static void event_cache_destroy(void *arg)
+{
+    event_cache_flush((event_cache_t *)arg, 0);
+}
+
+static void event_cache_key_init(void)
+{
+    pthread_key_create(&event_cache_key, event_cache_destroy);
+}
+
+static event_cache_t *event_cache_get(void)
+{
+    event_cache_t *cache = &event_cache;
+    if (!cache->registered) {
+        pthread_once(&event_cache_once, event_cache_key_init);
+        pthread_setspecific(event_cache_key, cache);
+        cache->registered = 1;
+    }
+    return cache;
+}
+
+static void release_event_chain(event_t * event)
+{
+    while (event) {
+        event_t *next = event->next;
+        dt_release_event(event);
+        event = next;
+    }
+}
+
+struct event_route_slot {
+    int id;
+    event_server_t *server;     // NULL: empty slot
+};
+
+struct event_route {
+    uint32_t mask;
+    struct event_route_slot slot[];
+};
+
+static inline uint32_t route_hash(int id)
+{
+    return (uint32_t)id * 2654435761U;
+}
+
+/* build snapshot from server list, call with server_lock held */
+static struct event_route *route_build(dt_server_mgt_t * mgt)
+{
+    struct event_route *route;
+    event_server_t *entry;
+    uint32_t size = 8;
+
+    while (size < (uint32_t)mgt->server_count * 2) {
+        size <<= 1;
+    }
+    route = (struct event_route *)calloc(1, sizeof(*route) + size * sizeof(struct event_route_slot));
+    if (!route) {
+        return NULL;
+    }
+    route->mask = size - 1;
+    for (entry = mgt->server; entry && mgt->server_count > 0; entry = entry->next) {
+        uint32_t i = route_hash(entry->id) & route->mask;
+        while (route->slot[i].server) {
+            i = (i + 1) & route->mask;
+        }
+        route->slot[i].id = entry->id;
+        route->slot[i].server = entry;
+    }
+    return route;
+}
+
+static event_server_t *route_lookup(struct event_route *route, int id)
+{
+    uint32_t i;
+    if (!route) {
+        return NULL;
+    }
+    i = route_hash(id) & route->mask;
+    while (route->slot[i].server) {
+        if (route->slot[i].id == id) {
+            return route->slot[i].server;
+        }
+        i = (i + 1) & route->mask;
+    }
+    return NULL;
+}
+
+/*
+ * route readers: one slot per thread, a cache line each, never freed
+ * a reader stores the current epoch in its own slot while routing and 0
+ * when done, it touches no line another sender writes. a writer publishes
+ * the new route, bumps the epoch and waits for every slot holding an older
+ * epoch; slot store / route load and route store / slot load are seq_cst,
+ * so either the writer sees the reader or the reader sees the new route.
+ */
+struct route_reader {
+    uint64_t epoch;                 // 0: not routing
+    int used;                       // owned by a live thread
+    struct route_reader *next;
+} __attribute__((aligned(DT_CACHELINE_SIZE)));
+
+static uint64_t route_epoch = 1;
+static struct route_reader *route_readers;
+static __thread struct route_reader *route_reader_self;
+static pthread_key_t route_reader_key;
+static pthread_once_t route_reader_once = PTHREAD_ONCE_INIT;
+
+/* thread exit: slot goes back for reuse */
+static void route_reader_destroy(void *arg)
+{
+    dt_atomic_store_release(&((struct route_reader *)arg)->used, 0);
+}
+
+static void route_reader_key_init(void)
+{
+    pthread_key_create(&route_reader_key, route_reader_destroy);
+}
+
+static struct route_reader *route_reader_get(void)
+{
+    struct route_reader *r = route_reader_self;
+    int expect;
+
+    if (r) {
+        return r;
+    }
+    pthread_once(&route_reader_once, route_reader_key_init);
+    for (r = dt_atomic_load_acquire(&route_readers); r; r = r->next) {
+        expect = 0;
+        if (dt_atomic_cas_weak(&r->used, &expect, 1)) {
+            break;
+        }
+    }
+    if (!r) {
+        if (posix_memalign((void **)&r, DT_CACHELINE_SIZE, sizeof(*r))) {
+            return NULL;
+        }
+        r->epoch = 0;
+        r->used = 1;
+        r->next = dt_atomic_load(&route_readers);
+        while (!dt_atomic_cas_weak(&route_readers, &r->next, r)) {
+            ;
+        }
+    }
+    pthread_setspecific(route_reader_key, r);
+    route_reader_self = r;
+    return r;
+}
+
+/* returns the route to use until route_read_unlock, NULL slot: no memory */
+static struct event_route *route_read_lock(dt_server_mgt_t * mgt, struct route_reader **slot)
+{
+    struct route_reader *r = route_reader_get();
+
+    *slot = r;
+    if (!r) {
+        return NULL;
+    }
+    dt_atomic_store_seq(&r->epoch, dt_atomic_load(&route_epoch));
+    return dt_atomic_load_seq(&mgt->route);
+}
+
+static void route_read_unlock(struct route_reader *r)
+{
+    if (r) {
+        dt_atomic_store_release(&r->epoch, 0);
+    }
+}
+
+/*
+ * writer side, call with server_lock held
+ * publish new snapshot and wait until no reader can see the old one
+ */
+static int route_update(dt_server_mgt_t * mgt)
+{
+    struct event_route *old = mgt->route;
+    struct event_route *route = route_build(mgt);
+    struct route_reader *r;
+    uint64_t epoch, seen;
+
+    if (!route) {
+        return -1;
+    }
+    dt_atomic_store_seq(&mgt->route, route);
+    epoch = dt_atomic_fetch_add(&route_epoch, 1) + 1;
+    for (r = dt_atomic_load_acquire(&route_readers); r; r = r->next) {
+        while ((seen = dt_atomic_load_seq(&r->epoch)) != 0 && seen < epoch) {
+            sched_yield();
+        }
+    }
+    free(old);
+    return 0;
+}
+
+static inline int event_lane(event_t * event)
+{
+    return DT_MAX(EVENT_PRIORITY_LOW, DT_MIN(event->priority, EVENT_PRIORITY_NUM - 1));
+}
+
+/* call with event_lock held, merge event into a pending one of same type */
+static int coalesce_event_locked(event_server_t * server, event_t * event)
+{
+    event_t *entry;
+    for (entry = server->event[event_lane(event)]; entry; entry = entry->next) {
+        if (entry->type == event->type) {
+            entry->arg = event->arg;
+            dt_release_event(event);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * call with event_lock held, append a next-linked chain
+ * runs of equal priority are spliced into their lane in O(1)
+ */
+static void append_chain_locked(event_server_t * server, event_t * event)
+{
+    while (event) {
+        event_t *first = event;
+        event_t *last = event;
+        int lane = event_lane(first);
+        int count = 1;
+
+        if (server->coalesce) {
+            event = event->next;
+            if (coalesce_event_locked(server, first)) {
+                continue;
+            }
+        } else {
+            while (last->next && event_lane(last->next) == lane) {
+                last = last->next;
+                count++;
+            }
+            event = last->next;
+        }
+        last->next = NULL;
+        if (!server->event[lane]) {
+            server->event[lane] = first;
+        } else {
+            server->event_tail[lane]->next = first;
+        }
+        server->event_tail[lane] = last;
+        server->event_count += count;
+    }
+}
+
+static void append_event_locked(event_server_t * server, event_t * event)
+{
+    event->next = NULL;
+    append_chain_locked(server, event);
+}
+
+/* call with event_lock held, detach all lanes as one chain, highest first */
+static event_t *pop_all_locked(event_server_t * server)
+{
+    event_t *head = NULL;
+    event_t *tail = NULL;
+    int lane;
+
+    for (lane = EVENT_PRIORITY_NUM - 1; lane >= 0; lane--) {
+        if (!server->event[lane]) {
+            continue;
+        }
+        if (tail) {
+            tail->next = server->event[lane];
+        } else {
+            head = server->event[lane];
+        }
+        tail = server->event_tail[lane];
+        server->event[lane] = NULL;
+        server->event_tail[lane] = NULL;
+    }
+    server->event_count = 0;
+    return head;
+}
+
+/* call with event_lock held */
+static void wakeup_server(event_server_t * server)
+{
+    if (dt_atomic_load_seq(&server->waiters) > 0) {
+        pthread_cond_broadcast(&server->event_cond);
+    }
+}
+
+/* push a next-linked chain into server inbox, chain order kept */
+static void inbox_push(event_server_t * server, event_t * event)
+{
+    event_t *first = NULL;
+    event_t *last = event;
+    event_t *head;
+
+    // inbox is newest first, reverse the chain before linking it
+    while (event) {
+        event_t *next = event->next;
+        event->next = first;
+        first = event;
+        event = next;
+    }
+    head = dt_atomic_load(&server->inbox);
+    do {
+        last->next = head;
+    } while (!dt_atomic_cas_weak(&server->inbox, &head, first));
+
+    dt_atomic_fence();
+    if (dt_atomic_load_seq(&server->waiters) > 0) {
+        dt_lock(&server->event_lock);
+        pthread_cond_broadcast(&server->event_cond);
+        dt_unlock(&server->event_lock);
+    }
+}
+
+/* call with event_lock held, move inbox into lanes */
+static void inbox_drain_locked(event_server_t * server)
+{
+    event_t *event;
+    event_t *chain = NULL;
+
+    if (!dt_atomic_load(&server->inbox)) {
+        return;
+    }
+    event = dt_atomic_exchange(&server->inbox, NULL);
+    while (event) {
+        event_t *next = event->next;
+        event->next = chain;
+        chain = event;
+        event = next;
+    }
+    append_chain_locked(server, chain);
+}
+
+/*
+ * wait with event_lock held until event arrives, timeout or exit_flag set
+ * timeout <= 0 waits forever
+ */
+static void wait_server(event_server_t * server, int timeout, int *exit_flag)
+{
+    struct timespec abstime;
+    int ret = 0;
+
+    if (timeout > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &abstime);
+        abstime.tv_sec += timeout / 1000;
+        abstime.tv_nsec += (long)(timeout % 1000) * 1000000;
+        if (abstime.tv_nsec >= 1000000000) {
+            abstime.tv_sec++;
+            abstime.tv_nsec -= 1000000000;
+        }
+    }
+    dt_atomic_fetch_add(&server->waiters, 1);
+    // pairs with the fence in inbox_push: waiters visible before the inbox check
+    dt_atomic_fence();
+    while (ret == 0 && !(exit_flag && *exit_flag)) {
+        if (server->event_count == 0) {
+            inbox_drain_locked(server);
+        }
+        if (server->event_count > 0) {
+            break;
+        }
+        if (timeout > 0) {
+            ret = pthread_cond_timedwait(&server->event_cond, &server->event_lock, &abstime);
+        } else {
+            ret = pthread_cond_wait(&server->event_cond, &server->event_lock);
+        }
+    }
+    dt_atomic_fetch_sub(&server->waiters, 1);
+}
 
 dt_server_mgt_t *dt_event_server_create()
+{
+    return dt_event_server_create2(0);
+}
+
+dt_server_mgt_t *dt_event_server_create2(int flags)
 {
     pthread_t tid;
     int ret = 0;
@@ -86,11 +537,12 @@ dt_server_mgt_t *dt_event_server_create()
     mgt->server = NULL;
     mgt->server_count = 0;
     mgt->exit_flag = 0;
+    mgt->flags = flags;
+    mgt->route = NULL;
     dt_lock_init(&mgt->server_lock, NULL);
 
     event_server_t *server = dt_alloc_server(EVENT_SERVER_ID_MAIN, EVENT_SERVER_NAME_MAIN);
     server->event_count = 0;
-    server->event = NULL;
     server->next = NULL;
     dt_lock_init(&server->event_lock, NULL);
 
@@ -101,6 +553,10 @@ dt_server_mgt_t *dt_event_server_create()
         goto end;
     }
 
+    if (mgt->flags & DT_EVENT_FLAG_DIRECT) {
+        dt_info(TAG, "DIRECT ROUTE MODE, NO TRANSPORT LOOP \n");
+        goto end;
+    }
     ret = pthread_create(&tid, NULL, (void *) &event_transport_loop, mgt);
     if (ret != 0) {
         dt_error(TAG, "TRANSTROP LOOP CREATE FAILED \n");
@@ -112,7 +568,7 @@ dt_server_mgt_t *dt_event_server_create()
 end:
     if (ret < 0) {
         free(server);
-        free(mgt);
+        dt_free(mgt);
     }
     return mgt;
 }
@@ -123,10 +579,17 @@ end:
  * */
 int dt_event_server_release(dt_server_mgt_t *mgt)
 {
+    event_server_t *server_hub = mgt->server;
+    /*stop loop, loop may need server_lock - join before taking it */
+    if (!(mgt->flags & DT_EVENT_FLAG_DIRECT)) {
+        dt_lock(&server_hub->event_lock);
+        mgt->exit_flag = 1;
+        pthread_cond_broadcast(&server_hub->event_cond);
+        dt_unlock(&server_hub->event_lock);
+        pthread_join(mgt->transport_loop_id, NULL);
+    }
+
     dt_lock(&mgt->server_lock);
-    /*stop loop */
-    mgt->exit_flag = 1;
-    pthread_join(mgt->transport_loop_id, NULL);
     /*
      * Remove server & event
      * */
@@ -134,21 +597,32 @@ int dt_event_server_release(dt_server_mgt_t *mgt)
     event_server_t *entry_next = NULL;
     while (entry) {
         entry_next = entry->next;
-        dt_remove_server(mgt, entry);
+        server_free(entry);
         entry = entry_next;
     }
+    mgt->server = NULL;
 
     dt_unlock(&mgt->server_lock);
-    free(mgt);
+    free(mgt->route);
+    dt_free(mgt);
     return 0;
 }
 
 event_server_t *dt_alloc_server(int id, char *name)
 {
+    pthread_condattr_t attr;
     event_server_t *server = (event_server_t *) malloc(sizeof(event_server_t));
     if (server) {
-        server->event = NULL;
+        memset(server->event, 0, sizeof(server->event));
+        memset(server->event_tail, 0, sizeof(server->event_tail));
+        server->coalesce = 0;
+        server->inbox = NULL;
         server->event_count = 0;
+        server->waiters = 0;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&server->event_cond, &attr);
+        pthread_condattr_destroy(&attr);
         server->id = id;
         if (strlen(name) < MAX_EVENT_SERVER_NAME_LEN) {
             strcpy(server->name, name);
@@ -164,6 +638,13 @@ event_server_t *dt_alloc_server(int id, char *name)
     return server;
 }
 
+void dt_server_set_coalesce(event_server_t * server, int enable)
+{
+    dt_lock(&server->event_lock);
+    server->coalesce = enable ? 1 : 0;
+    dt_unlock(&server->event_lock);
+}
+
 int dt_register_server(dt_server_mgt_t *mgt, event_server_t * server)
 {
     int ret = 0;
@@ -172,16 +653,16 @@ int dt_register_server(dt_server_mgt_t *mgt, event_server_t * server)
         return -1;
     }
     dt_lock(&mgt->server_lock);
+    if (route_lookup(mgt->route, server->id)) {
+        dt_error(TAG, "SERVICE HAS BEEN REGISTERD BEFORE\n");
+        ret = -1;
+        goto FAIL;
+    }
     if (mgt->server_count == 0) {
         mgt->server = server;
     }
     event_server_t *entry = mgt->server;
     while (entry->next != NULL) {
-        if (entry->id == server->id) {
-            dt_error(TAG, "SERVICE HAS BEEN REGISTERD BEFORE\n");
-            ret = -1;
-            goto FAIL;
-        }
         entry = entry->next;
     }
     if (entry->next == NULL) {
@@ -189,6 +670,18 @@ int dt_register_server(dt_server_mgt_t *mgt, event_server_t * server)
         server->next = NULL;
         mgt->server_count++;
     }
+    if (route_update(mgt) < 0) {
+        // old route is still published, unlink so list and route agree
+        if (entry == server) {
+            mgt->server = NULL;
+        } else {
+            entry->next = NULL;
+        }
+        mgt->server_count--;
+        dt_error(TAG, "SERVICE ROUTE UPDATE FAILED\n");
+        ret = -1;
+        goto FAIL;
+    }
     dt_unlock(&mgt->server_lock);
     dt_info(TAG, "SERVICE:%s REGISTER OK,SERVERCOUNT:%d \n", server->name, mgt->server_count);
     return 0;
@@ -204,29 +697,26 @@ FAIL:
     for normal server, need to remove event and server
  */
 
-int dt_remove_server(dt_server_mgt_t *mgt, event_server_t * server)
+/* drop pending events and free, no sender may reach server any more */
+static void server_free(event_server_t * server)
 {
-    int count = server->event_count;
-    event_server_t *entry = mgt->server;
-
-    dt_info(TAG, "REMOVE %s \n", server->name);
-    /*remove all events */
-    if (count == 0) {
-        goto REMOVE_SERVICE;
+    dt_lock(&server->event_lock);
+    inbox_drain_locked(server);
+    release_event_chain(pop_all_locked(server));
+    dt_unlock(&server->event_lock);
+    if (server->event_count > 0) {
+        dt_warning(TAG, "EVENT COUNT !=0 AFTER REMOVE \n");
     }
-    event_t *event = server->event;
-    event_t *event_next = event->next;
+    dt_info(TAG, "Remove server:%s success \n", server->name);
+    pthread_cond_destroy(&server->event_cond);
+    free(server);
+}
 
-    while (event) {
-        free(event);
-        server->event_count--;
-        event = event_next;
-        if (event) {
-            event_next = event->next;
-        }
-    }
+static int remove_server_locked(dt_server_mgt_t *mgt, event_server_t * server)
+{
+    event_server_t *entry = mgt->server;
 
-REMOVE_SERVICE:
+    dt_info(TAG, "REMOVE %s \n", server->name);
     while (entry->next && entry->next->id != server->id) {
         entry = entry->next;
     }
@@ -234,18 +724,43 @@ REMOVE_SERVICE:
     if (entry->next && entry->next->id == server->id) {
         entry->next = entry->next->next;
         mgt->server_count--;
+        // no router may still hold server after this, keep it if the old route stays
+        if (route_update(mgt) < 0) {
+            server->next = entry->next;
+            entry->next = server;
+            mgt->server_count++;
+            dt_error(TAG, "SERVICE ROUTE UPDATE FAILED, %s NOT REMOVED\n", server->name);
+            return -1;
+        }
     }
-    if (server->event_count > 0) {
-        dt_warning(TAG, "EVENT COUNT !=0 AFTER REMOVE \n");
-    }
-    dt_info(TAG, "Remove server:%s success \n", server->name);
-    free(server);
+
+    /*remove all events, direct senders are gone after route_update */
+    server_free(server);
     return 0;
 }
 
+int dt_remove_server(dt_server_mgt_t *mgt, event_server_t * server)
+{
+    int ret;
+    dt_lock(&mgt->server_lock);
+    ret = remove_server_locked(mgt, server);
+    dt_unlock(&mgt->server_lock);
+    return ret;
+}
+
 event_t *dt_alloc_event(int server, int type)
 {
-    event_t *event = (event_t *) malloc(sizeof(event_t));
+    event_cache_t *cache = event_cache_get();
+    event_t *event;
+
+    if (cache->count == 0) {
+        event_cache_refill(cache);
+    }
+    if (cache->count > 0) {
+        event = cache->event[--cache->count];
+    } else {
+        event = (event_t *) malloc(sizeof(event_t));
+    }
     if (!event) {
         dt_error(TAG, "EVENT ALLOC FAILED \n");
         return NULL;
@@ -253,9 +768,24 @@ event_t *dt_alloc_event(int server, int type)
     event->next = NULL;
     event->server_id = server;
     event->type = type;
+    event->arg = 0;
+    event->priority = EVENT_PRIORITY_NORMAL;
     return event;
 }
 
+void dt_release_event(event_t * event)
+{
+    event_cache_t *cache;
+    if (!event) {
+        return;
+    }
+    cache = event_cache_get();
+    if (cache->count == EVENT_CACHE_SIZE) {
+        event_cache_flush(cache, EVENT_CACHE_SIZE / 2);
+    }
+    cache->event[cache->count++] = event;
+}
+
 int dt_send_event_sync(dt_server_mgt_t *mgt, event_t * event)
 {
     event_server_t *server_hub = mgt->server;
@@ -263,8 +793,10 @@ int dt_send_event_sync(dt_server_mgt_t *mgt, event_t * event)
         dt_error(TAG, "EVENT SEND FAILED \n");
         return -1;
     }
+    int type = event->type;
+    event->next = NULL;
     dt_transport_event(event, mgt);
-    dt_debug(TAG, "EVENT:%d BYPASS SEND OK \n");
+    DT_LOGD(TAG, "EVENT:%d BYPASS SEND OK \n", type);
     return 0;
 }
 
@@ -275,56 +807,87 @@ int dt_send_event(dt_server_mgt_t *mgt, event_t * event)
         dt_error(TAG, "EVENT SEND FAILED \n");
         return -1;
     }
-    dt_lock(&server_hub->event_lock);
-    if (server_hub->event_count == 0) {
-        server_hub->event = event;
-    } else {
-        event_t *entry = server_hub->event;
-        while (entry->next) {
-            entry = entry->next;
-        }
-        entry->next = event;
-
+    if (mgt->flags & DT_EVENT_FLAG_DIRECT) {
+        event->next = NULL;
+        return dt_transport_event(event, mgt);
     }
-    server_hub->event_count++;
+    // event may be coalesced or routed and freed once appended
+    int type = event->type;
+    int count;
+    dt_lock(&server_hub->event_lock);
+    append_event_locked(server_hub, event);
+    count = server_hub->event_count;
+    wakeup_server(server_hub);
     dt_unlock(&server_hub->event_lock);
-    dt_debug(TAG, "EVENT:%d SEND OK, event count:%d \n", event->type, server_hub->event_count);
+    DT_LOGD(TAG, "EVENT:%d SEND OK, event count:%d \n", type, count);
     return 0;
 }
 
-static int dt_add_event(event_t * event, event_server_t * server)
+int dt_send_event_batch_sync(dt_server_mgt_t *mgt, event_t * event)
 {
-    event_server_t *server_hub = server;
-    if (!server_hub) {
-        dt_error(TAG, "EVENT SEND FAILED \n");
+    if (!mgt->server || !event) {
+        dt_error(TAG, "EVENT BATCH SEND FAILED \n");
         return -1;
     }
-    dt_lock(&server_hub->event_lock);
-    if (server_hub->event_count == 0) {
-        server_hub->event = event;
-    } else {
-        event_t *entry = server_hub->event;
-        while (entry->next) {
-            entry = entry->next;
-        }
-        entry->next = event;
+    return dt_transport_event(event, mgt);
+}
 
+int dt_send_event_batch(dt_server_mgt_t *mgt, event_t * event)
+{
+    event_server_t *server_hub = mgt->server;
+
+    if (!server_hub || !event) {
+        dt_error(TAG, "EVENT BATCH SEND FAILED \n");
+        return -1;
     }
-    server_hub->event_count++;
+    if (mgt->flags & DT_EVENT_FLAG_DIRECT) {
+        return dt_transport_event(event, mgt);
+    }
+    int count;
+    dt_lock(&server_hub->event_lock);
+    append_chain_locked(server_hub, event);
+    count = server_hub->event_count;
+    wakeup_server(server_hub);
     dt_unlock(&server_hub->event_lock);
+    DT_LOGD(TAG, "EVENT BATCH SEND OK, event count:%d \n", count);
     return 0;
 }
 
 event_t *dt_peek_event(event_server_t * server)
 {
     event_t *entry = NULL;
+    int lane;
     dt_lock(&server->event_lock);
-    if (server->event_count > 0) {
-        entry = server->event;
+    inbox_drain_locked(server);
+    for (lane = EVENT_PRIORITY_NUM - 1; lane >= 0 && !entry; lane--) {
+        entry = server->event[lane];
     }
     dt_unlock(&server->event_lock);
     if (entry != NULL) {
-        dt_info(TAG, "PEEK EVENT:%d From Server:%s \n", entry->type, server->name);
+        DT_LOGD(TAG, "PEEK EVENT:%d From Server:%s \n", entry->type, server->name);
+    }
+    return entry;
+}
+
+/* call with event_lock held, head of highest non-empty lane */
+static event_t *pop_event_locked(event_server_t * server)
+{
+    event_t *entry = NULL;
+    int lane;
+    if (server->event_count == 0) {
+        return NULL;
+    }
+    for (lane = EVENT_PRIORITY_NUM - 1; lane >= 0; lane--) {
+        entry = server->event[lane];
+        if (entry) {
+            server->event[lane] = entry->next;
+            if (!entry->next) {
+                server->event_tail[lane] = NULL;
+            }
+            server->event_count--;
+            entry->next = NULL;
+            break;
+        }
     }
     return entry;
 }
@@ -333,49 +896,73 @@ event_t *dt_get_event(event_server_t * server)
 {
     event_t *entry = NULL;
     dt_lock(&server->event_lock);
-    if (server->event_count > 0) {
-        entry = server->event;
-        server->event = entry->next;
-        server->event_count--;
-        entry->next = NULL;
+    inbox_drain_locked(server);
+    entry = pop_event_locked(server);
+    dt_unlock(&server->event_lock);
+    if (entry != NULL) {
+        DT_LOGD(TAG, "GET EVENT:%d From Server:%s \n", entry->type, server->name);
     }
+    return entry;
+}
+
+event_t *dt_get_event_timeout(event_server_t * server, int timeout)
+{
+    event_t *entry = NULL;
+    dt_lock(&server->event_lock);
+    wait_server(server, timeout, NULL);
+    inbox_drain_locked(server);
+    entry = pop_event_locked(server);
     dt_unlock(&server->event_lock);
     if (entry != NULL) {
-        dt_info(TAG, "GET EVENT:%d From Server:%s \n", entry->type, server->name);
+        DT_LOGD(TAG, "GET EVENT:%d From Server:%s \n", entry->type, server->name);
     }
     return entry;
 }
 
+/*
+ * route a chain of events in one pass
+ * consecutive events for the same server are appended under one event_lock,
+ * or pushed into its inbox with one cas in direct mode
+ * events for unknown servers are released
+ */
 static int dt_transport_event(event_t * event, dt_server_mgt_t * mgt)
 {
-    dt_lock(&mgt->server_lock);
-    event_server_t *entry = mgt->server;
-
+    struct route_reader *reader;
+    struct event_route *route = route_read_lock(mgt, &reader);
     int ret = 0;
-    while (entry->id != event->server_id) {
-        entry = entry->next;
-        if (!entry) {
-            break;
-        }
-    }
 
-    if (!entry) {
-        dt_error(TAG, "Could not found server for:%d \n ", event->server_id);
-        ret = -1;
-        goto FAIL;
+    if (!reader) {
+        dt_error(TAG, "ROUTE READER ALLOC FAILED \n");
+        release_event_chain(event);
+        return -1;
     }
 
-    ret = dt_add_event(event, entry);
-    if (ret < 0) {              //we need to free this event
-        dt_error(TAG, "we can not transport this event, id:%d type:%d\n ", event->server_id, event->type);
-        free(event);
-        ret = -1;
-        goto FAIL;
+    while (event) {
+        event_t *first = event;
+        event_t *last = event;
+        while (last->next && last->next->server_id == first->server_id) {
+            last = last->next;
+        }
+        event = last->next;
+        last->next = NULL;
+
+        event_server_t *entry = route_lookup(route, first->server_id);
+        if (!entry) {
+            dt_error(TAG, "Could not found server for:%d \n ", first->server_id);
+            release_event_chain(first);
+            ret = -1;
+            continue;
+        }
+        if (mgt->flags & DT_EVENT_FLAG_DIRECT) {
+            inbox_push(entry, first);
+            continue;
+        }
+        dt_lock(&entry->event_lock);
+        append_chain_locked(entry, first);
+        wakeup_server(entry);
+        dt_unlock(&entry->event_lock);
     }
-    dt_unlock(&mgt->server_lock);
-    return ret;
-FAIL:
-    dt_unlock(&mgt->server_lock);
+    route_read_unlock(reader);
     return ret;
 }
 
@@ -385,15 +972,17 @@ static void *event_transport_loop(void *arg)
     event_server_t *server_hub = mgt->server;
     event_t *event = NULL;
     do {
+        dt_lock(&server_hub->event_lock);
+        wait_server(server_hub, 0, &mgt->exit_flag);
         if (mgt->exit_flag) {
+            dt_unlock(&server_hub->event_lock);
             goto QUIT;
         }
-        event = dt_get_event(server_hub);
-        if (!event) {
-            usleep(10 * 1000);
-            continue;
+        event = pop_all_locked(server_hub);
+        dt_unlock(&server_hub->event_lock);
+        if (event) {
+            dt_transport_event(event, mgt);
         }
-        dt_transport_event(event, mgt);
     } while (1);
 
 QUIT:
@@ -14,9 +14,14 @@
  * =====================================================================================
  */
 
+#include <assert.h>
+
 #include "dt_fifo.h"
+#include "dt_macro.h"
+
+#define dt_assert2(cond) assert(cond)
 
-static dt_fifo *fifo_alloc_common(void *buffer, size_t size)
+static dt_fifo *fifo_alloc_common(void *buffer, size_t size, int flags)
 {
     dt_fifo *f;
     if (!buffer) {
@@ -24,31 +29,62 @@ static dt_fifo *fifo_alloc_common(void *buffer, size_t size)
     }
     f = dt_mallocz(sizeof(dt_fifo));
     if (!f) {
-        dt_free(buffer);
+        if (flags & DT_FIFO_FLAG_MIRROR) {
+            dt_mirror_free(buffer, size);
+        } else {
+            dt_free(buffer);
+        }
         return NULL;
     }
     f->buffer = buffer;
     f->end    = f->buffer + size;
+    f->flags  = flags;
     dt_fifo_reset(f);
     return f;
 }
 
+static void fifo_free_buffer(dt_fifo *f)
+{
+    if (f->flags & DT_FIFO_FLAG_MIRROR) {
+        dt_mirror_free(f->buffer, f->end - f->buffer);
+        f->buffer = NULL;
+    } else {
+        dt_freep(&f->buffer);
+    }
+}
+
+/* bytes accessible without wrapping from ptr, ptr in [buffer, end) */
+static inline int fifo_contig(const dt_fifo *f, const uint8_t *ptr)
+{
+    if (f->flags & DT_FIFO_FLAG_MIRROR) {
+        return f->end - ptr + (f->end - f->buffer);
+    }
+    return f->end - ptr;
+}
+
 dt_fifo *dt_fifo_alloc(unsigned int size)
 {
     void *buffer = dt_malloc(size);
-    return fifo_alloc_common(buffer, size);
+    return fifo_alloc_common(buffer, size, 0);
+}
+
+dt_fifo *dt_fifo_alloc_mirror(unsigned int size)
+{
+    size_t len = size;
+    void *buffer = dt_mirror_alloc(&len);
+    return fifo_alloc_common(buffer, len, DT_FIFO_FLAG_MIRROR);
 }
 
 dt_fifo *dt_fifo_alloc_array(size_t nmemb, size_t size)
 {
     void *buffer = dt_malloc_array(nmemb, size);
-    return fifo_alloc_common(buffer, nmemb * size);
+    return fifo_alloc_common(buffer, nmemb * size, 0);
 }
 
 void dt_fifo_free(dt_fifo *f)
 {
     if (f) {
-        dt_freep(&f->buffer);
+        fifo_free_buffer(f);
         dt_free(f);
     }
 }
@@ -83,7 +119,8 @@ int dt_fifo_realloc2(dt_fifo *f, unsigned int new_size)
 
     if (old_size < new_size) {
         int len          = dt_fifo_size(f);
-        dt_fifo *f2 = dt_fifo_alloc(new_size);
+        dt_fifo *f2 = (f->flags & DT_FIFO_FLAG_MIRROR) ?
+                      dt_fifo_alloc_mirror(new_size) : dt_fifo_alloc(new_size);
 
         if (!f2) {
             return DTERROR(ENOMEM);
@@ -91,7 +128,7 @@ int dt_fifo_realloc2(dt_fifo *f, unsigned int new_size)
         dt_fifo_generic_read(f, f2->buffer, len, NULL);
         f2->wptr += len;
         f2->wndx += len;
-        dt_free(f->buffer);
+        fifo_free_buffer(f);
         *f = *f2;
         dt_free(f2);
     }
@@ -108,7 +145,7 @@ int dt_fifo_grow(dt_fifo *f, unsigned int size)
     size += dt_fifo_size(f);
 
     if (old_size < size) {
-        return dt_fifo_realloc2(f, FFMAX(size, 2 * size));
+        return dt_fifo_realloc2(f, DT_MAX(size, 2 * size));
     }
     return 0;
 }
@@ -123,7 +160,7 @@ int dt_fifo_generic_write(dt_fifo *f, void *src, int size,
     uint8_t *wptr = f->wptr;
 
     do {
-        int len = FFMIN(f->end - wptr, size);
+        int len = DT_MIN(fifo_contig(f, wptr), size);
         if (func) {
             len = func(src, wptr, len);
             if (len <= 0) {
@@ -136,7 +173,7 @@ int dt_fifo_generic_write(dt_fifo *f, void *src, int size,
         // Write memory barrier needed for SMP here in theory
         wptr += len;
         if (wptr >= f->end) {
-            wptr = f->buffer;
+            wptr -= f->end - f->buffer;
         }
         wndx    += len;
         size    -= len;
@@ -171,7 +208,7 @@ int dt_fifo_generic_peek_at(dt_fifo *f, void *dest, int offset, int buf_size, vo
             rptr -= f->end - f->buffer;
         }
 
-        len = FFMIN(f->end - rptr, buf_size);
+        len = DT_MIN(fifo_contig(f, rptr), buf_size);
         if (func) {
             func(dest, rptr, len);
         } else {
@@ -193,7 +230,7 @@ int dt_fifo_generic_peek(dt_fifo *f, void *dest, int buf_size,
     uint8_t *rptr = f->rptr;
 
     do {
-        int len = FFMIN(f->end - rptr, buf_size);
+        int len = DT_MIN(fifo_contig(f, rptr), buf_size);
         if (func) {
             func(dest, rptr, len);
         } else {
@@ -216,7 +253,7 @@ int dt_fifo_generic_read(dt_fifo *f, void *dest, int buf_size,
 {
     // Read memory barrier needed for SMP here in theory
     do {
-        int len = FFMIN(f->end - f->rptr, buf_size);
+        int len = DT_MIN(fifo_contig(f, f->rptr), buf_size);
         if (func) {
             func(dest, f->rptr, len);
         } else {
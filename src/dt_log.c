@@ -5,6 +5,16 @@
 #include <string.h>
 #include <stdarg.h>
 #include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "dt_atomic.h"
+#include "dt_buffer.h"
+#include "dt_lock.h"
+#include "dt_time.h"
 
 #if ENABLE_ANDROID
 
@@ -25,10 +35,60 @@
 #define KCYN  "\x1B[36m"
 #define KWHT  "\x1B[37m"
 
+#define LOG_LINE_MAX     1024
+#define LOG_RING_SIZE    (64 * 1024)
+#define LOG_IOV_MAX      64
+#define LOG_IDLE_WAIT_MS 100
 
-static int dt_log_level = DT_LOG_INFO; // default print INFO+ Level
+int dt_log_level = DT_LOG_INFO; // default print INFO+ Level
 //static FILE * dt_fp = NULL;
 
+/*
+ * async mode
+ * every logging thread owns an spsc ring, it formats a whole line and
+ * puts it in one go. the writer thread is the only consumer of all rings
+ * and hands them to the sink with one writev per round.
+ * rings live until their thread exits, so a ring pointer cached in tls
+ * stays valid across dt_log_async_stop / start.
+ */
+struct log_ring {
+    dt_buffer_t buf;
+    int closed;             // owner thread exited
+    int len;                // bytes in this writev round
+    struct log_ring *next;
+};
+
+static int log_fd = -1;                     // -1: stdout through stdio
+static int log_async;
+static int log_exit;
+static int log_sleeping;
+static int log_ring_size = LOG_RING_SIZE;
+static pthread_t log_tid;
+static dt_lock_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond;
+static struct log_ring *log_rings;          // protected by log_lock
+
+static __thread struct log_ring *log_ring;
+static __thread int log_busy;
+static pthread_key_t log_ring_key;
+static pthread_once_t log_ring_once = PTHREAD_ONCE_INIT;
+
+/*
+ * wall clock prefix cache
+ * the "[YYYY-mm-dd HH:MM:SS" prefix changes once a second. readers copy it
+ * under a seqlock, the first thread to see a new second rebuilds it. a
+ * reader racing a rebuild formats its own copy instead of waiting.
+ */
+struct log_time_cache {
+    uint32_t seq;           // odd while being rebuilt
+    int len;
+    int64_t sec;
+    char str[48];
+};
+
+static struct log_time_cache log_time_cache = { .sec = -1 };
+static int log_time_mode = DT_LOG_TIME_WALL;
+
 static int check_level(int level)
 {
     return level >= dt_log_level;
@@ -45,29 +105,339 @@ static int tag_enable(char *filter, char *tag)
     return 1;
 }
 
-static int display_time()
+static int log_time_format(int64_t sec, char *buf, int size)
+{
+    time_t timer = (time_t)sec;
+    struct tm tm_info;
+    int len;
+
+    localtime_r(&timer, &tm_info);
+    len = snprintf(buf, size, "%s[", KYEL);
+    len += strftime(buf + len, size - len, "%Y-%m-%d %H:%M:%S", &tm_info);
+    return len;
+}
+
+static int log_time_cached(int64_t sec, char *buf, int size)
+{
+    struct log_time_cache *cache = &log_time_cache;
+    uint32_t seq = dt_atomic_load_acquire(&cache->seq);
+    int len;
+
+    if (!(seq & 1) && dt_atomic_load(&cache->sec) == sec) {
+        len = dt_atomic_load(&cache->len);
+        memcpy(buf, cache->str, len);
+        dt_atomic_fence_acquire();
+        if (dt_atomic_load(&cache->seq) == seq) {
+            return len;
+        }
+    }
+    len = log_time_format(sec, buf, size);
+    // one rebuilder, the others keep their own copy
+    if (!(seq & 1) && len < (int)sizeof(cache->str) && dt_atomic_cas_weak(&cache->seq, &seq, seq + 1)) {
+        // odd seq visible before the stores below, pairs with the reader's acquire fence
+        dt_atomic_fence_release();
+        memcpy(cache->str, buf, len);
+        dt_atomic_store(&cache->len, len);
+        dt_atomic_store(&cache->sec, sec);
+        dt_atomic_store_release(&cache->seq, seq + 2);
+    }
+    return len;
+}
+
+static int display_time(char *buf, int size)
+{
+    int mode = dt_atomic_load(&log_time_mode);
+    int64_t now;
+    int len;
+
+    if (mode == DT_LOG_TIME_MONO) {
+        now = dt_gettime_relative();
+        return snprintf(buf, size, "%s[%lld.%06lld]", KYEL, (long long)(now / 1000000),
+                        (long long)(now % 1000000));
+    }
+    now = dt_gettime() / 1000000;
+    if (mode == DT_LOG_TIME_WALL_NOCACHE) {
+        len = log_time_format(now, buf, size);
+    } else {
+        len = log_time_cached(now, buf, size);
+    }
+    buf[len++] = ']';
+    return len;
+}
+
+static const char *log_level_str(int level)
+{
+    switch (level) {
+    case DT_LOG_INVALID:
+        return "[Invalid]";
+    case DT_LOG_ERROR:
+        return KRED "[ERROR]";
+    case DT_LOG_DEBUG:
+        return KBLU "[DEBUG]";
+    case DT_LOG_WARNING:
+        return KGRN "[WARNING]";
+    case DT_LOG_INFO:
+        return "[INFO]";
+    default:
+        return KRED "[Invalid]";
+    }
+}
+
+/* one complete line, cut at LOG_LINE_MAX but always newline terminated */
+static int log_format(char *buf, int level, const char *tag, const char *fmt, va_list vl)
+{
+    int len = display_time(buf, LOG_LINE_MAX);
+    int n;
+
+    len += snprintf(buf + len, LOG_LINE_MAX - len, "%s%s: [%s] ", log_level_str(level), KNRM, tag);
+    // a long tag may fill the line, keep room for the terminator
+    if (len > LOG_LINE_MAX - 1) {
+        len = LOG_LINE_MAX - 1;
+    }
+    n = vsnprintf(buf + len, LOG_LINE_MAX - len, fmt, vl);
+    if (n < 0) {
+        n = 0;
+    }
+    if (len + n >= LOG_LINE_MAX) {
+        len = LOG_LINE_MAX - 1;
+        buf[len - 1] = '\n';
+    } else {
+        len += n;
+    }
+    return len;
+}
+
+static void log_write_fd(int fd, const char *buf, int len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static void log_write_sync(const char *buf, int len)
 {
-    time_t timer;
-    char buffer[25];
-    struct tm* tm_info;
-    time(&timer);
-    tm_info = localtime(&timer);
-    strftime(buffer, 25, "%Y-%m-%d %H:%M:%S", tm_info);
-    printf("%s[%s]", KYEL, buffer);
+    int fd = dt_atomic_load(&log_fd);
+    if (fd < 0) {
+        // stdio locks the stream per call, one fwrite keeps the line whole
+        fwrite(buf, 1, len, stdout);
+        return;
+    }
+    log_write_fd(fd, buf, len);
+}
+
+static void log_writev_all(int fd, struct iovec *iov, int cnt)
+{
+    while (cnt > 0) {
+        ssize_t n = writev(fd, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        while (cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/*
+ * hand everything queued so far to the sink, returns bytes written
+ * log_lock is held throughout: exited threads' rings are freed here and
+ * the lock keeps that away from a concurrent stop/flush
+ */
+static int log_flush(void)
+{
+    struct iovec iov[LOG_IOV_MAX];
+    struct log_ring *ring, **pp;
+    dtbuf_span_t span;
+    int fd, cnt = 0, total = 0;
+
+    dt_lock(&log_lock);
+    pp = &log_rings;
+    while ((ring = *pp) != NULL) {
+        ring->len = 0;
+        if (cnt + 2 <= LOG_IOV_MAX) {
+            ring->len = dtbuf_peek(&ring->buf, &span, ring->buf.size);
+        }
+        if (!ring->len && ring->closed && !dtbuf_level(&ring->buf)) {
+            *pp = ring->next;
+            dtbuf_release(&ring->buf);
+            free(ring);
+            continue;
+        }
+        if (ring->len) {
+            iov[cnt].iov_base = span.ptr[0];
+            iov[cnt++].iov_len = span.len[0];
+            if (span.len[1]) {
+                iov[cnt].iov_base = span.ptr[1];
+                iov[cnt++].iov_len = span.len[1];
+            }
+            total += ring->len;
+        }
+        pp = &ring->next;
+    }
+    if (cnt) {
+        fd = dt_atomic_load(&log_fd);
+        log_writev_all(fd < 0 ? STDOUT_FILENO : fd, iov, cnt);
+        for (ring = log_rings; ring; ring = ring->next) {
+            if (ring->len) {
+                dtbuf_consume(&ring->buf, ring->len);
+            }
+        }
+    }
+    dt_unlock(&log_lock);
+    return total;
+}
+
+static int log_pending(void)
+{
+    struct log_ring *ring;
+    for (ring = log_rings; ring; ring = ring->next) {
+        if (dtbuf_level(&ring->buf) > 0) {
+            return 1;
+        }
+    }
     return 0;
 }
 
-void dt_log(void *tag, int level, const char *fmt, ...)
+static void *log_writer_loop(void *arg)
 {
-    if (!check_level(level)) {
+    struct timespec ts;
+
+    (void)arg;
+    for (;;) {
+        if (log_flush() > 0) {
+            continue;
+        }
+        if (dt_atomic_load_acquire(&log_exit)) {
+            break;
+        }
+        dt_lock(&log_lock);
+        dt_atomic_store_seq(&log_sleeping, 1);
+        dt_atomic_fence();
+        if (!log_pending() && !dt_atomic_load(&log_exit)) {
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ts.tv_nsec += LOG_IDLE_WAIT_MS * 1000000L;
+            ts.tv_sec += ts.tv_nsec / 1000000000L;
+            ts.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&log_cond, &log_lock, &ts);
+        }
+        dt_atomic_store(&log_sleeping, 0);
+        dt_unlock(&log_lock);
+    }
+    return NULL;
+}
+
+static void log_wake(void)
+{
+    // pairs with the fence in log_writer_loop, see dt_event inbox_push
+    dt_atomic_fence();
+    if (dt_atomic_load(&log_sleeping)) {
+        dt_lock(&log_lock);
+        pthread_cond_signal(&log_cond);
+        dt_unlock(&log_lock);
+    }
+}
+
+/* thread exit: the writer frees the ring once drained */
+static void log_ring_destroy(void *arg)
+{
+    struct log_ring *ring = (struct log_ring *)arg;
+    dt_lock(&log_lock);
+    ring->closed = 1;
+    dt_unlock(&log_lock);
+    log_ring = NULL;
+}
+
+static void log_ring_key_init(void)
+{
+    pthread_key_create(&log_ring_key, log_ring_destroy);
+}
+
+static struct log_ring *log_ring_get(void)
+{
+    struct log_ring *ring = log_ring;
+    if (ring) {
+        return ring;
+    }
+    pthread_once(&log_ring_once, log_ring_key_init);
+    ring = (struct log_ring *)malloc(sizeof(struct log_ring));
+    if (!ring) {
+        return NULL;
+    }
+    // dtbuf_init2 logs, that line takes the sync path
+    log_busy = 1;
+    if (dtbuf_init2(&ring->buf, dt_atomic_load(&log_ring_size), DTBUF_FLAG_SPSC) < 0) {
+        log_busy = 0;
+        free(ring);
+        return NULL;
+    }
+    log_busy = 0;
+    ring->closed = 0;
+    ring->len = 0;
+    dt_lock(&log_lock);
+    ring->next = log_rings;
+    log_rings = ring;
+    dt_unlock(&log_lock);
+    pthread_setspecific(log_ring_key, ring);
+    log_ring = ring;
+    return ring;
+}
+
+/* 0: queued, -1: caller writes synchronously */
+static int log_write_async(const char *buf, int len)
+{
+    struct log_ring *ring = log_ring_get();
+    if (!ring || len > ring->buf.size) {
+        return -1;
+    }
+    // ring full: wait for the writer rather than drop the line
+    while (dtbuf_space(&ring->buf) < len) {
+        if (!dt_atomic_load(&log_async)) {
+            return -1;
+        }
+        log_wake();
+        sched_yield();
+    }
+    dtbuf_put(&ring->buf, (uint8_t *)buf, len);
+    log_wake();
+    return 0;
+}
+
+static void log_vprint(int level, const char *tag, const char *fmt, va_list vl)
+{
+    char buf[LOG_LINE_MAX];
+    int len = log_format(buf, level, tag, fmt, vl);
+
+    if (dt_atomic_load(&log_async) && !log_busy && log_write_async(buf, len) == 0) {
         return;
     }
+    log_write_sync(buf, len);
+}
 
-    dt_get_log_level(DT_LOG_ERROR);
-    printf("[%s] ", (char *) tag);
+void dt_log(void *tag, DT_LOG_LEVEL level, const char *fmt, ...)
+{
+    if (!check_level(level)) {
+        return;
+    }
     va_list vl;
     va_start(vl, fmt);
-    vprintf(fmt, vl);
+    log_vprint(level, (const char *)tag, fmt, vl);
     va_end(vl);
 }
 
@@ -76,12 +446,9 @@ void dt_error(void *tag, const char *fmt, ...)
     if (!check_level(DT_LOG_ERROR)) {
         return;
     }
-    display_time();
-    dt_get_log_level(DT_LOG_ERROR);
-    printf("[%s] ", (char *) tag);
     va_list vl;
     va_start(vl, fmt);
-    vprintf(fmt, vl);
+    log_vprint(DT_LOG_ERROR, (const char *)tag, fmt, vl);
     va_end(vl);
 }
 
@@ -90,12 +457,9 @@ void dt_debug(void *tag, const char *fmt, ...)
     if (!check_level(DT_LOG_DEBUG)) {
         return;
     }
-    display_time();
-    dt_get_log_level(DT_LOG_DEBUG);
-    printf("[%s] ", (char *) tag);
     va_list vl;
     va_start(vl, fmt);
-    vprintf(fmt, vl);
+    log_vprint(DT_LOG_DEBUG, (const char *)tag, fmt, vl);
     va_end(vl);
 }
 
@@ -104,12 +468,9 @@ void dt_warning(void *tag, const char *fmt, ...)
     if (!check_level(DT_LOG_WARNING)) {
         return;
     }
-    display_time();
-    dt_get_log_level(DT_LOG_WARNING);
-    printf("[%s] ", (char *) tag);
     va_list vl;
     va_start(vl, fmt);
-    vprintf(fmt, vl);
+    log_vprint(DT_LOG_WARNING, (const char *)tag, fmt, vl);
     va_end(vl);
 }
 
@@ -118,15 +479,67 @@ void dt_info(void *tag, const char *fmt, ...)
     if (!check_level(DT_LOG_INFO)) {
         return;
     }
-    display_time();
-    dt_get_log_level(DT_LOG_INFO);
-    printf("[%s] ", (char *) tag);
     va_list vl;
     va_start(vl, fmt);
-    vprintf(fmt, vl);
+    log_vprint(DT_LOG_INFO, (const char *)tag, fmt, vl);
     va_end(vl);
 }
 
+void dt_log_set_time(int mode)
+{
+    dt_atomic_store(&log_time_mode, mode);
+}
+
+void dt_log_set_sink(int fd)
+{
+    if (dt_atomic_load(&log_fd) < 0) {
+        fflush(stdout);
+    }
+    dt_atomic_store(&log_fd, fd);
+}
+
+int dt_log_async_start(int ring_size)
+{
+    pthread_condattr_t attr;
+
+    if (dt_atomic_load(&log_async)) {
+        return 0;
+    }
+    if (ring_size > 0) {
+        // applies to rings of threads that have not logged yet
+        dt_atomic_store(&log_ring_size, ring_size < LOG_LINE_MAX ? LOG_LINE_MAX : ring_size);
+    }
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&log_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    // earlier sync lines sit in the stdio buffer, keep them first
+    fflush(stdout);
+    dt_atomic_store(&log_exit, 0);
+    if (pthread_create(&log_tid, NULL, log_writer_loop, NULL) != 0) {
+        pthread_cond_destroy(&log_cond);
+        return -1;
+    }
+    dt_atomic_store_release(&log_async, 1);
+    return 0;
+}
+
+void dt_log_async_stop(void)
+{
+    if (!dt_atomic_load(&log_async)) {
+        return;
+    }
+    dt_atomic_store_seq(&log_async, 0);
+    dt_lock(&log_lock);
+    dt_atomic_store_release(&log_exit, 1);
+    pthread_cond_signal(&log_cond);
+    dt_unlock(&log_lock);
+    pthread_join(log_tid, NULL);
+    // lines queued while the writer was exiting
+    log_flush();
+    pthread_cond_destroy(&log_cond);
+}
+
 void dt_set_log_level(int level)
 {
     dt_log_level = level;
@@ -138,30 +551,7 @@ void dt_set_log_level(int level)
 /*get log level string desc*/
 void dt_get_log_level(int level)
 {
-    switch (level) {
-    case DT_LOG_INVALID:
-        printf("[Invalid]");
-        break;
-    case DT_LOG_ERROR:
-        printf("%s[ERROR]", KRED);
-        break;
-    case DT_LOG_DEBUG:
-        printf("%s[DEBUG]", KBLU);
-        break;
-    case DT_LOG_WARNING:
-        printf("%s[WARNING]", KGRN);
-        break;
-    case DT_LOG_INFO:
-        printf("[INFO]");
-        break;
-    case DT_LOG_MAX:
-        printf("%s[Invalid]", KRED);
-        break;
-    default:
-        printf("%s[Invalid]", KRED);
-        break;
-    }
-    printf("%s: ", KNRM);
+    printf("%s%s: ", log_level_str(level), KNRM);
 }
 
 #if 0
@@ -171,7 +561,7 @@ int main()
     dt_info("TEST", "this is info level test \n");
     dt_error("TEST", "this is error level test \n");
     dt_debug("TEST", "this is debug level test \n");
-    dt_warning("TEST", "this is warnning level test \n");
+    dt_warning("TEST", "this is warning level test \n");
     dt_set_log_level(1);
     dt_info("TEST", "this is info level test \n");
     dt_error("TEST", "this is error level test \n");
@@ -19,9 +19,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
+#define DT_MEM_NO_SITE
+#include "dt_atomic.h"
+#include "dt_log.h"
 #include "dt_mem.h"
 
+#define TAG "DT_MEM"
+
+#ifndef DT_MEM_ALIGN
+#define DT_MEM_ALIGN 16
+#endif
+#define ALIGN DT_MEM_ALIGN
+
 static size_t max_alloc_size = INT_MAX;
 
 void dt_max_alloc(size_t max)
@@ -29,7 +42,7 @@ void dt_max_alloc(size_t max)
     max_alloc_size = max;
 }
 
-void *dt_malloc(size_t size)
+static void *mem_alloc(size_t size)
 {
     void *ptr = NULL;
 #if CONFIG_MEMALIGN_HACK
@@ -91,7 +104,7 @@ void *dt_malloc(size_t size)
 #endif
     if (!ptr && !size) {
         size = 1;
-        ptr = dt_malloc(1);
+        ptr = mem_alloc(1);
     }
 #if CONFIG_MEMORY_POISONING
     if (ptr) {
@@ -101,7 +114,7 @@ void *dt_malloc(size_t size)
     return ptr;
 }
 
-void *dt_realloc(void *ptr, size_t size)
+static void *mem_realloc(void *ptr, size_t size)
 {
 #if CONFIG_MEMALIGN_HACK
     int diff;
@@ -115,7 +128,7 @@ void *dt_realloc(void *ptr, size_t size)
 #if CONFIG_MEMALIGN_HACK
     //FIXME this isn't aligned correctly, though it probably isn't needed
     if (!ptr) {
-        return dt_malloc(size);
+        return mem_alloc(size);
     }
     diff = ((char *)ptr)[-1];
     dt_assert0(diff > 0 && diff <= ALIGN);
@@ -126,6 +139,20 @@ void *dt_realloc(void *ptr, size_t size)
     return ptr;
 #elif HAVE_ALIGNED_MALLOC
     return _aligned_realloc(ptr, size + !size, ALIGN);
+#elif HAVE_POSIX_MEMALIGN
+    // realloc keeps only malloc alignment, move misaligned results
+    void *ret = realloc(ptr, size + !size);
+    if (ret && ((uintptr_t)ret & (ALIGN - 1))) {
+        void *aligned = mem_alloc(size + !size);
+        // old block is gone already, keep the data misaligned rather than lose it
+        if (!aligned) {
+            return ret;
+        }
+        memcpy(aligned, ret, size + !size);
+        free(ret);
+        ret = aligned;
+    }
+    return ret;
 #else
     return realloc(ptr, size + !size);
 #endif
@@ -190,7 +217,7 @@ int dt_reallocp_array(void *ptr, size_t nmemb, size_t size)
     return 0;
 }
 
-void dt_free(void *ptr)
+static void mem_free(void *ptr)
 {
 #if CONFIG_MEMALIGN_HACK
     if (ptr) {
@@ -205,6 +232,234 @@ void dt_free(void *ptr)
 #endif
 }
 
+/*
+ * tracked block: [pad][struct mem_hdr][user data], MEM_HDR_SIZE keeps
+ * user data DT_MEM_ALIGN aligned. tracking only starts before the first
+ * allocation, so every block freed while tracking carries a header.
+ */
+#define MEM_HDR_SIZE ((sizeof(struct mem_hdr) + ALIGN - 1) & ~(size_t)(ALIGN - 1))
+
+struct mem_hdr {
+    dt_mem_site_t *site;
+    size_t size;
+};
+
+static int mem_track;
+static int mem_used;                // set by the first untracked allocation
+static dt_mem_site_t *mem_sites;
+static dt_mem_site_t mem_site_unknown = { .file = "unknown", .line = 0 };
+static dt_mem_stat_t mem_total;
+
+static inline struct mem_hdr *mem_hdr_of(void *ptr)
+{
+    return (struct mem_hdr *)ptr - 1;
+}
+
+static void mem_site_register(dt_mem_site_t *site)
+{
+    int expect = 0;
+    dt_mem_site_t *head;
+
+    if (!dt_atomic_cas_weak(&site->registered, &expect, 1)) {
+        return;
+    }
+    head = dt_atomic_load(&mem_sites);
+    do {
+        site->next = head;
+    } while (!dt_atomic_cas_weak(&mem_sites, &head, site));
+}
+
+static void mem_stat_add(dt_mem_stat_t *stat, int64_t size)
+{
+    int64_t live = __atomic_add_fetch(&stat->live, size, __ATOMIC_RELAXED);
+    int64_t peak;
+
+    if (size <= 0) {
+        return;
+    }
+    __atomic_add_fetch(&stat->count, 1, __ATOMIC_RELAXED);
+    peak = dt_atomic_load(&stat->peak);
+    while (live > peak && !dt_atomic_cas_weak(&stat->peak, &peak, live)) {
+        ;
+    }
+}
+
+static void mem_account(dt_mem_site_t *site, int64_t size)
+{
+    // the cas in register can fail spuriously, retry until registered
+    while (!dt_atomic_load_acquire(&site->registered)) {
+        mem_site_register(site);
+    }
+    mem_stat_add(&site->stat, size);
+    mem_stat_add(&mem_total, size);
+}
+
+static void *mem_track_alloc(size_t size, dt_mem_site_t *site)
+{
+    uint8_t *raw;
+    struct mem_hdr *hdr;
+
+    if (size > max_alloc_size - 32 - MEM_HDR_SIZE) {
+        return NULL;
+    }
+    raw = (uint8_t *)mem_alloc(size + MEM_HDR_SIZE);
+    if (!raw) {
+        return NULL;
+    }
+    hdr = mem_hdr_of(raw + MEM_HDR_SIZE);
+    hdr->site = site;
+    hdr->size = size;
+    mem_account(site, (int64_t)size);
+    return raw + MEM_HDR_SIZE;
+}
+
+static void *mem_track_realloc(void *ptr, size_t size, dt_mem_site_t *site)
+{
+    struct mem_hdr *hdr;
+    dt_mem_site_t *old_site;
+    size_t old_size;
+    uint8_t *raw;
+
+    if (!ptr) {
+        return mem_track_alloc(size, site);
+    }
+    hdr = mem_hdr_of(ptr);
+    if (size > max_alloc_size - 32 - MEM_HDR_SIZE) {
+        return NULL;
+    }
+    old_site = hdr->site;
+    old_size = hdr->size;
+    raw = (uint8_t *)mem_realloc((uint8_t *)ptr - MEM_HDR_SIZE, size + MEM_HDR_SIZE);
+    if (!raw) {
+        return NULL;
+    }
+    hdr = mem_hdr_of(raw + MEM_HDR_SIZE);
+    hdr->site = site;
+    hdr->size = size;
+    mem_account(old_site, -(int64_t)old_size);
+    mem_account(site, (int64_t)size);
+    return raw + MEM_HDR_SIZE;
+}
+
+static void mem_track_free(void *ptr)
+{
+    struct mem_hdr *hdr = mem_hdr_of(ptr);
+
+    mem_account(hdr->site, -(int64_t)hdr->size);
+    mem_free((uint8_t *)ptr - MEM_HDR_SIZE);
+}
+
+static void mem_track_exit(void)
+{
+    dt_mem_track_dump(1);
+}
+
+int dt_mem_track_enable(void)
+{
+    if (dt_atomic_load(&mem_track)) {
+        return 0;
+    }
+    if (dt_atomic_load(&mem_used)) {
+        dt_error(TAG, "TRACK ENABLE AFTER FIRST ALLOCATION, IGNORED\n");
+        return -1;
+    }
+    if (dt_atomic_exchange(&mem_track, 1) == 0) {
+        atexit(mem_track_exit);
+    }
+    return 0;
+}
+
+int dt_mem_track_enabled(void)
+{
+    return dt_atomic_load(&mem_track);
+}
+
+__attribute__((constructor)) static void mem_track_env(void)
+{
+    const char *env = getenv("DT_MEM_TRACK");
+    if (env && atoi(env) > 0) {
+        dt_mem_track_enable();
+    }
+}
+
+void dt_mem_track_total(dt_mem_stat_t *stat)
+{
+    stat->live = dt_atomic_load(&mem_total.live);
+    stat->peak = dt_atomic_load(&mem_total.peak);
+    stat->count = dt_atomic_load(&mem_total.count);
+}
+
+void dt_mem_track_dump(int leaks_only)
+{
+    dt_mem_site_t *site;
+    dt_mem_stat_t total;
+    int leaks = 0;
+
+    if (!dt_mem_track_enabled()) {
+        return;
+    }
+    dt_mem_track_total(&total);
+    dt_info(TAG, "live:%lld peak:%lld count:%lld\n",
+            (long long)total.live, (long long)total.peak, (long long)total.count);
+    for (site = dt_atomic_load_acquire(&mem_sites); site; site = site->next) {
+        int64_t live = dt_atomic_load(&site->stat.live);
+        if (leaks_only && !live) {
+            continue;
+        }
+        if (live) {
+            leaks++;
+        }
+        dt_info(TAG, "%s:%d live:%lld peak:%lld count:%lld\n", site->file, site->line,
+                (long long)live, (long long)dt_atomic_load(&site->stat.peak),
+                (long long)dt_atomic_load(&site->stat.count));
+    }
+    if (leaks) {
+        dt_warning(TAG, "%d call sites hold memory\n", leaks);
+    }
+}
+
+void *dt_malloc_site(size_t size, dt_mem_site_t *site)
+{
+    if (__builtin_expect(dt_atomic_load(&mem_track), 0)) {
+        return mem_track_alloc(size, site);
+    }
+    // plain load first, keeps the line shared once set
+    if (__builtin_expect(!dt_atomic_load(&mem_used), 0)) {
+        dt_atomic_store(&mem_used, 1);
+    }
+    return mem_alloc(size);
+}
+
+void *dt_malloc(size_t size)
+{
+    return dt_malloc_site(size, &mem_site_unknown);
+}
+
+void *dt_realloc_site(void *ptr, size_t size, dt_mem_site_t *site)
+{
+    if (__builtin_expect(dt_atomic_load(&mem_track), 0)) {
+        return mem_track_realloc(ptr, size, site);
+    }
+    if (__builtin_expect(!dt_atomic_load(&mem_used), 0)) {
+        dt_atomic_store(&mem_used, 1);
+    }
+    return mem_realloc(ptr, size);
+}
+
+void *dt_realloc(void *ptr, size_t size)
+{
+    return dt_realloc_site(ptr, size, &mem_site_unknown);
+}
+
+void dt_free(void *ptr)
+{
+    if (__builtin_expect(dt_atomic_load(&mem_track), 0) && ptr) {
+        mem_track_free(ptr);
+        return;
+    }
+    mem_free(ptr);
+}
+
 void dt_freep(void *arg)
 {
     void *val;
@@ -216,29 +471,39 @@ void dt_freep(void *arg)
     dt_free(val);
 }
 
-void *dt_mallocz(size_t size)
+void *dt_mallocz_site(size_t size, dt_mem_site_t *site)
 {
-    void *ptr = dt_malloc(size);
+    void *ptr = dt_malloc_site(size, site);
     if (ptr) {
         memset(ptr, 0, size);
     }
     return ptr;
 }
 
-void *dt_calloc(size_t nmemb, size_t size)
+void *dt_mallocz(size_t size)
+{
+    return dt_mallocz_site(size, &mem_site_unknown);
+}
+
+void *dt_calloc_site(size_t nmemb, size_t size, dt_mem_site_t *site)
 {
     if (size <= 0 || nmemb >= INT_MAX / size) {
         return NULL;
     }
-    return dt_mallocz(nmemb * size);
+    return dt_mallocz_site(nmemb * size, site);
 }
 
-char *dt_strdup(const char *s)
+void *dt_calloc(size_t nmemb, size_t size)
+{
+    return dt_calloc_site(nmemb, size, &mem_site_unknown);
+}
+
+char *dt_strdup_site(const char *s, dt_mem_site_t *site)
 {
     char *ptr = NULL;
     if (s) {
         size_t len = strlen(s) + 1;
-        ptr = dt_realloc(NULL, len);
+        ptr = dt_realloc_site(NULL, len, site);
         if (ptr) {
             memcpy(ptr, s, len);
         }
@@ -246,7 +511,12 @@ char *dt_strdup(const char *s)
     return ptr;
 }
 
-char *dt_strndup(const char *s, size_t len)
+char *dt_strdup(const char *s)
+{
+    return dt_strdup_site(s, &mem_site_unknown);
+}
+
+char *dt_strndup_site(const char *s, size_t len, dt_mem_site_t *site)
 {
     char *ret = NULL, *end;
 
@@ -259,7 +529,7 @@ char *dt_strndup(const char *s, size_t len)
         len = end - s;
     }
 
-    ret = dt_realloc(NULL, len + 1);
+    ret = dt_realloc_site(NULL, len + 1, site);
     if (!ret) {
         return NULL;
     }
@@ -269,11 +539,16 @@ char *dt_strndup(const char *s, size_t len)
     return ret;
 }
 
-void *dt_memdup(const void *p, size_t size)
+char *dt_strndup(const char *s, size_t len)
+{
+    return dt_strndup_site(s, len, &mem_site_unknown);
+}
+
+void *dt_memdup_site(const void *p, size_t size, dt_mem_site_t *site)
 {
     void *ptr = NULL;
     if (p) {
-        ptr = dt_malloc(size);
+        ptr = dt_malloc_site(size, site);
         if (ptr) {
             memcpy(ptr, p, size);
         }
@@ -281,4 +556,58 @@ void *dt_memdup(const void *p, size_t size)
     return ptr;
 }
 
+void *dt_memdup(const void *p, size_t size)
+{
+    return dt_memdup_site(p, size, &mem_site_unknown);
+}
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+void *dt_mirror_alloc(size_t *size)
+{
+#if defined(__NR_memfd_create)
+    long page = sysconf(_SC_PAGESIZE);
+    size_t len = (*size + page - 1) / page * page;
+    uint8_t *base = NULL;
+    int fd;
+
+    if (!len || len > max_alloc_size) {
+        return NULL;
+    }
+    fd = syscall(__NR_memfd_create, "dt_mirror", MFD_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, len) < 0) {
+        goto fail;
+    }
 
+    // reserve 2 * len of address space, then map the same pages over both halves
+    base = mmap(NULL, 2 * len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        base = NULL;
+        goto fail;
+    }
+    if (mmap(base, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + len, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * len);
+        base = NULL;
+        goto fail;
+    }
+    *size = len;
+fail:
+    close(fd);
+    return base;
+#else
+    return NULL;
+#endif
+}
+
+void dt_mirror_free(void *ptr, size_t size)
+{
+    if (ptr) {
+        munmap(ptr, 2 * size);
+    }
+}
@@ -17,209 +17,672 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
-#include "list.h"
+#include "dt_atomic.h"
 #include "dt_lock.h"
+#include "dt_log.h"
+#include "dt_macro.h"
 #include "dt_mm_pool.h"
 
 #define TAG "MM_POOL"
 
-struct mm_item {
-    struct list_head list;
-    uint8_t *ptr;
-    int size;
-};
+#define MM_MAP_FLAGS (DT_MM_POOL_MMAP | DT_MM_POOL_HUGEPAGE | DT_MM_POOL_HUGETLB | \
+                      DT_MM_POOL_POPULATE | DT_MM_POOL_NUMA)
+#define MM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define MM_MPOL_BIND      2
+
+/*
+ * pool memory is split in physically adjacent blocks, each starts with
+ * an inline header (boundary tag) holding the previous physical block
+ * and its own size, so a freed block merges with both neighbours in O(1)
+ * and the free set never holds two adjacent blocks.
+ *
+ * free blocks link into a bin list through their payload.
+ * default mode: one list, first-fit scan
+ * size-class mode: two-level bins, fl = log2(size), sl splits each power
+ * of two in BIN_SL_COUNT ranges, non-empty bins are tracked in
+ * fl_bitmap / sl_bitmap so a fitting bin is found with ctz.
+ */
+#define BLOCK_ALIGN      16
+#define BLOCK_HDR_SIZE   16
+#define BLOCK_MIN_SIZE   16                         // room for free links
+#define BLOCK_FREE       0x1
+#define BLOCK_CACHED     0x2                        // used, parked in a thread cache
+#define BLOCK_FLAGS      (BLOCK_FREE | BLOCK_CACHED)
+
+#define BIN_SL_LOG2      2
+#define BIN_SL_COUNT     (1 << BIN_SL_LOG2)
+#define BIN_FL_SHIFT     (BIN_SL_LOG2 + 4)          // 4: log2(BLOCK_ALIGN)
+#define BIN_SMALL_SIZE   (1 << BIN_FL_SHIFT)
+#define BIN_FL_COUNT     (64 - BIN_FL_SHIFT + 1)
 
-struct mm_list {
-    struct list_head list;
+/*
+ * thread cache: per class stack of blocks still marked used in the pool
+ * classes follow the size-class bins, requests are rounded up to the
+ * class lower bound so any cached block of that class fits
+ */
+#define TCACHE_MAX_LOG2     22                      // cache blocks up to 4MB
+#define TCACHE_MAX_SIZE     (1 << TCACHE_MAX_LOG2)
+#define TCACHE_CLASS_COUNT  ((TCACHE_MAX_LOG2 - BIN_FL_SHIFT + 1) * BIN_SL_COUNT + 1)
+#define TCACHE_SLOTS        16
+#define TCACHE_CLASS_BYTES  (1 << 20)               // bytes cached per class
+
+typedef struct mm_block {
+    struct mm_block *prev_phys;     // NULL for first block
+    size_t size;                    // payload size | BLOCK_FREE | BLOCK_CACHED
+    // free blocks only, overlaps payload
+    struct mm_block *next_free;
+    struct mm_block *prev_free;
+} mm_block_t;
+
+struct mm_stat {
     int64_t size;
     int count;
 };
 
+struct mm_tcache {
+    struct dt_mm_pool *pool;
+    struct mm_tcache *next;
+    int count[TCACHE_CLASS_COUNT];
+    uint8_t *slot[TCACHE_CLASS_COUNT][TCACHE_SLOTS];
+};
+
 struct dt_mm_pool {
     uint8_t *mem;
+    uint8_t *end;
     int64_t size;
+    int flags;
+    size_t map_size;                // mmap backing only, 0 for malloc
+
+    struct mm_stat mluse;
+    struct mm_stat mlfree;
 
-    struct mm_list mluse;
-    struct mm_list mlfree;
+    uint64_t fl_bitmap;
+    uint32_t sl_bitmap[BIN_FL_COUNT];
+    mm_block_t *bins[BIN_FL_COUNT][BIN_SL_COUNT];
+
+    // DT_MM_POOL_THREAD_CACHE
+    pthread_key_t tcache_key;
+    struct mm_tcache *tcache;       // all thread caches, under tcache_lock
 
     dt_lock_t mutex;
 };
 
-struct dt_mm_pool *dt_mm_pool_create(int64_t size)
+static dt_lock_t tcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline size_t block_size(mm_block_t *block)
 {
-    struct dt_mm_pool *pool = (struct dt_mm_pool *)malloc(sizeof(struct dt_mm_pool));
-    if (!pool) {
+    return block->size & ~(size_t)BLOCK_FLAGS;
+}
+
+static inline int block_is_free(mm_block_t *block)
+{
+    return block->size & BLOCK_FREE;
+}
+
+static inline uint8_t *block_payload(mm_block_t *block)
+{
+    return (uint8_t *)block + BLOCK_HDR_SIZE;
+}
+
+/* next physical block, NULL at pool end */
+static inline mm_block_t *block_next(struct dt_mm_pool *pool, mm_block_t *block)
+{
+    uint8_t *next = block_payload(block) + block_size(block);
+    return next + BLOCK_HDR_SIZE <= pool->end ? (mm_block_t *)next : NULL;
+}
+
+static inline int bin_fls(size_t size)
+{
+    return 63 - __builtin_clzll((unsigned long long)size);
+}
+
+static void size_mapping(size_t size, int *fl, int *sl)
+{
+    if (size < BIN_SMALL_SIZE) {
+        *fl = 0;
+        *sl = (int)(size / (BIN_SMALL_SIZE / BIN_SL_COUNT));
+    } else {
+        int t = bin_fls(size);
+        *sl = (int)(size >> (t - BIN_SL_LOG2)) ^ BIN_SL_COUNT;
+        *fl = t - BIN_FL_SHIFT + 1;
+    }
+}
+
+static inline size_t size_align(size_t size)
+{
+    return (DT_MAX(size, BLOCK_MIN_SIZE) + BLOCK_ALIGN - 1) & ~(size_t)(BLOCK_ALIGN - 1);
+}
+
+/* round size up to the lower bound of the next size class */
+static inline size_t size_round_up(size_t size)
+{
+    if (size >= BIN_SMALL_SIZE) {
+        size_t step = (size_t)1 << (bin_fls(size) - BIN_SL_LOG2);
+        size = (size + step - 1) & ~(step - 1);
+    }
+    return size;
+}
+
+static void bin_mapping(struct dt_mm_pool *pool, size_t size, int *fl, int *sl)
+{
+    if (!(pool->flags & DT_MM_POOL_SIZE_CLASS)) {
+        *fl = *sl = 0;
+        return;
+    }
+    size_mapping(size, fl, sl);
+}
+
+static void bin_insert(struct dt_mm_pool *pool, mm_block_t *block)
+{
+    int fl, sl;
+    bin_mapping(pool, block_size(block), &fl, &sl);
+    block->prev_free = NULL;
+    block->next_free = pool->bins[fl][sl];
+    if (block->next_free) {
+        block->next_free->prev_free = block;
+    }
+    pool->bins[fl][sl] = block;
+    pool->fl_bitmap |= 1ULL << fl;
+    pool->sl_bitmap[fl] |= 1U << sl;
+    block->size |= BLOCK_FREE;
+    pool->mlfree.count++;
+    pool->mlfree.size += block_size(block);
+}
+
+static void bin_remove(struct dt_mm_pool *pool, mm_block_t *block)
+{
+    int fl, sl;
+    bin_mapping(pool, block_size(block), &fl, &sl);
+    if (block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        pool->bins[fl][sl] = block->next_free;
+        if (!block->next_free) {
+            pool->sl_bitmap[fl] &= ~(1U << sl);
+            if (!pool->sl_bitmap[fl]) {
+                pool->fl_bitmap &= ~(1ULL << fl);
+            }
+        }
+    }
+    if (block->next_free) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    block->size &= ~(size_t)BLOCK_FREE;
+    pool->mlfree.count--;
+    pool->mlfree.size -= block_size(block);
+}
+
+/*
+ * size-class: first block of a bin whose every block holds size
+ * default: first block holding size
+ */
+static mm_block_t *bin_search(struct dt_mm_pool *pool, size_t size)
+{
+    mm_block_t *block;
+    uint64_t fl_map;
+    uint32_t sl_map;
+    int fl, sl;
+
+    if (!(pool->flags & DT_MM_POOL_SIZE_CLASS)) {
+        for (block = pool->bins[0][0]; block; block = block->next_free) {
+            if (block_size(block) >= size) {
+                return block;
+            }
+        }
         return NULL;
     }
-    memset(pool, 0, sizeof(struct dt_mm_pool));
-    pool->mem = (uint8_t *)malloc(size);
-    if (!pool->mem) {
-        free(pool);
+
+    bin_mapping(pool, size_round_up(size), &fl, &sl);
+    if (fl >= BIN_FL_COUNT) {
         return NULL;
     }
-    pool->size = size;
-    INIT_LIST_HEAD(&pool->mluse.list);
-    INIT_LIST_HEAD(&pool->mlfree.list);
+    sl_map = pool->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        fl_map = fl + 1 < 64 ? pool->fl_bitmap & (~0ULL << (fl + 1)) : 0;
+        if (!fl_map) {
+            return NULL;
+        }
+        fl = __builtin_ctzll(fl_map);
+        sl_map = pool->sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    return pool->bins[fl][sl];
+}
 
-    struct mm_item *item = (struct mm_item *)malloc(sizeof(struct mm_item));
-    item->ptr = pool->mem;
-    item->size = size;
-    INIT_LIST_HEAD(&item->list);
+/* link block before next physical block */
+static inline void block_link_next(struct dt_mm_pool *pool, mm_block_t *block)
+{
+    mm_block_t *next = block_next(pool, block);
+    if (next) {
+        next->prev_phys = block;
+    }
+}
 
-    pool->mlfree.size = size;
-    pool->mlfree.count++;
-    list_add_tail(&item->list, &pool->mlfree.list);
+static mm_block_t *block_merge(struct dt_mm_pool *pool, mm_block_t *prev, mm_block_t *block)
+{
+    prev->size += BLOCK_HDR_SIZE + block_size(block);
+    block_link_next(pool, prev);
+    return prev;
+}
 
-    dt_lock_init(&pool->mutex, NULL);
-    return pool;
+static uint8_t *block_alloc(struct dt_mm_pool *pool, size_t size)
+{
+    size_t adjust = size_align(size);
+    mm_block_t *block = bin_search(pool, adjust);
+    if (!block) {
+        return NULL;
+    }
+    bin_remove(pool, block);
+
+    // split off the tail if it can hold a block of its own
+    if (block_size(block) >= adjust + BLOCK_HDR_SIZE + BLOCK_MIN_SIZE) {
+        mm_block_t *rest = (mm_block_t *)(block_payload(block) + adjust);
+        rest->size = block_size(block) - adjust - BLOCK_HDR_SIZE;
+        rest->prev_phys = block;
+        block->size = adjust;
+        block_link_next(pool, rest);
+        bin_insert(pool, rest);
+    }
+    pool->mluse.count++;
+    pool->mluse.size += block_size(block);
+    return block_payload(block);
 }
 
-uint8_t *dt_mm_pool_alloc(struct dt_mm_pool *pool, int size)
+/* ptr is the payload of a used block: aligned and linked both ways */
+static int block_valid(struct dt_mm_pool *pool, uint8_t *ptr)
+{
+    mm_block_t *block = (mm_block_t *)(ptr - BLOCK_HDR_SIZE);
+    mm_block_t *prev, *next;
+
+    if (ptr < pool->mem + BLOCK_HDR_SIZE || ptr >= pool->end
+        || (size_t)(ptr - pool->mem) % BLOCK_ALIGN || (block->size & BLOCK_FLAGS)
+        || block_size(block) > (size_t)(pool->end - ptr)) {
+        return 0;
+    }
+    next = block_next(pool, block);
+    if (next && next->prev_phys != block) {
+        return 0;
+    }
+    prev = block->prev_phys;
+    if (!prev) {
+        return (uint8_t *)block == pool->mem;
+    }
+    return (uint8_t *)prev >= pool->mem && (uint8_t *)prev < (uint8_t *)block
+           && (size_t)((uint8_t *)prev - pool->mem) % BLOCK_ALIGN == 0
+           && block_next(pool, prev) == block;
+}
+
+static int block_free(struct dt_mm_pool *pool, uint8_t *ptr)
+{
+    mm_block_t *block = (mm_block_t *)(ptr - BLOCK_HDR_SIZE);
+    mm_block_t *next;
+
+    if (!block_valid(pool, ptr)) {
+        return -1;
+    }
+    pool->mluse.count--;
+    pool->mluse.size -= block_size(block);
+
+    // coalesce with both physical neighbours
+    if (block->prev_phys && block_is_free(block->prev_phys)) {
+        bin_remove(pool, block->prev_phys);
+        block = block_merge(pool, block->prev_phys, block);
+    }
+    next = block_next(pool, block);
+    if (next && block_is_free(next)) {
+        bin_remove(pool, next);
+        block = block_merge(pool, block, next);
+    }
+    bin_insert(pool, block);
+    return 0;
+}
+
+static int block_pool_init(struct dt_mm_pool *pool)
+{
+    mm_block_t *block = (mm_block_t *)pool->mem;
+    size_t size = (size_t)pool->size & ~(size_t)(BLOCK_ALIGN - 1);
+
+    if (size < BLOCK_HDR_SIZE + BLOCK_MIN_SIZE) {
+        return -1;
+    }
+    pool->end = pool->mem + size;
+    block->prev_phys = NULL;
+    block->size = size - BLOCK_HDR_SIZE;
+    bin_insert(pool, block);
+    return 0;
+}
+
+static inline int tcache_class(size_t size)
+{
+    int fl, sl;
+    size_mapping(size, &fl, &sl);
+    return fl * BIN_SL_COUNT + sl;
+}
+
+static inline int tcache_cap(size_t size)
+{
+    return (int)DT_MAX(2, DT_MIN(TCACHE_SLOTS, TCACHE_CLASS_BYTES / size));
+}
+
+/* give cached blocks of class c back to pool down to keep, one lock */
+static void tcache_flush(struct dt_mm_pool *pool, struct mm_tcache *tc, int c, int keep)
 {
-    uint8_t *palloc = NULL;
     dt_lock(&pool->mutex);
-    struct mm_list *ul = &pool->mluse;
-    struct mm_list *fl = &pool->mlfree;
-    struct mm_item *item_free;
-    struct list_head *list1, *list2;
-
-    // Find on free item
-    list_for_each_safe(list1, list2, &fl->list) {
-        item_free = list_entry(list1, struct mm_item, list);
-        if (item_free->size >= size) {
-            break;
-        }
-        item_free = NULL;
-    }
-    if (!item_free) {
-        goto end;
-    }
-
-    // Create one use item
-    struct mm_item *item_use = (struct mm_item *)malloc(sizeof(struct mm_item));
-    if (!item_use) {
-        goto end;
-    }
-    item_use->ptr = item_free->ptr;
-    item_use->size = size;
-    INIT_LIST_HEAD(&item_use->list);
-    list_add_tail(&item_use->list, &ul->list);
-    ul->count++;
-    ul->size += size;
-
-    // Update free list & maybe remove free item
-    palloc = item_free->ptr;
-    item_free->ptr += size;
-    item_free->size -= size;
-    fl->size -= size;
-    if (item_free->size == 0) {
-        list_del(&item_free->list);
-        free(item_free);
-        fl->count--;
-    }
-    dt_info(TAG, "alloc %d memory at:%p ok \n", size, palloc);
-end:
+    while (tc->count[c] > keep) {
+        uint8_t *ptr = tc->slot[c][--tc->count[c]];
+        dt_atomic_fetch_and(&((mm_block_t *)(ptr - BLOCK_HDR_SIZE))->size, ~(size_t)BLOCK_CACHED);
+        block_free(pool, ptr);
+    }
     dt_unlock(&pool->mutex);
-    return palloc;
 }
 
-int dt_mm_pool_free(struct dt_mm_pool *pool, uint8_t *ptr)
+/* thread exit */
+static void tcache_destroy(void *arg)
 {
-    int ret = -1;
-    dt_lock(&pool->mutex);
-    struct mm_list *ul = &pool->mluse;
-    struct mm_list *fl = &pool->mlfree;
-    struct mm_item *item_use;
-    struct list_head *list1, *list2;
-
-    // Find item use
-    list_for_each_safe(list1, list2, &ul->list) {
-        item_use = list_entry(list1, struct mm_item, list);
-        if (item_use->ptr == ptr) {
-            break;
+    struct mm_tcache *tc = (struct mm_tcache *)arg;
+    struct mm_tcache **pp;
+    int c;
+
+    dt_lock(&tcache_lock);
+    if (tc->pool) {
+        for (c = 0; c < TCACHE_CLASS_COUNT; c++) {
+            tcache_flush(tc->pool, tc, c, 0);
+        }
+        for (pp = &tc->pool->tcache; *pp; pp = &(*pp)->next) {
+            if (*pp == tc) {
+                *pp = tc->next;
+                break;
+            }
         }
-        item_use = NULL;
     }
-    if (!item_use) {
-        goto end;
+    dt_unlock(&tcache_lock);
+    free(tc);
+}
+
+static struct mm_tcache *tcache_get(struct dt_mm_pool *pool)
+{
+    struct mm_tcache *tc = (struct mm_tcache *)pthread_getspecific(pool->tcache_key);
+    if (tc) {
+        return tc;
+    }
+    tc = (struct mm_tcache *)calloc(1, sizeof(struct mm_tcache));
+    if (!tc) {
+        return NULL;
     }
+    tc->pool = pool;
+    dt_lock(&tcache_lock);
+    tc->next = pool->tcache;
+    pool->tcache = tc;
+    dt_unlock(&tcache_lock);
+    pthread_setspecific(pool->tcache_key, tc);
+    return tc;
+}
 
-    // Remove use item in use list
-    list_del(&item_use->list);
-    ul->count--;
-    ul->size -= item_use->size;
+static uint8_t *tcache_alloc(struct dt_mm_pool *pool, int size)
+{
+    struct mm_tcache *tc = tcache_get(pool);
+    size_t rsize = size_round_up(size_align(size));
+    int c = tcache_class(rsize);
+    uint8_t *ptr;
+    int n;
 
-    // Setup free list
-    struct mm_item *item_free = NULL;
-    list_for_each_safe(list1, list2, &ul->list) {
-        item_free = list_entry(list1, struct mm_item, list);
-        if ((item_free->ptr + item_free->size) == item_use->ptr) {
-            break;
+    if (!tc) {
+        return NULL;
+    }
+    if (tc->count[c] == 0) {
+        // batched refill, half of the class capacity
+        dt_lock(&pool->mutex);
+        for (n = DT_MAX(1, tcache_cap(rsize) / 2); n > 0; n--) {
+            ptr = block_alloc(pool, rsize);
+            if (!ptr) {
+                break;
+            }
+            tc->slot[c][tc->count[c]++] = ptr;
+        }
+        dt_unlock(&pool->mutex);
+        if (tc->count[c] == 0) {
+            return NULL;
         }
-        item_free = NULL;
     }
+    ptr = tc->slot[c][--tc->count[c]];
+    dt_atomic_fetch_and(&((mm_block_t *)(ptr - BLOCK_HDR_SIZE))->size, ~(size_t)BLOCK_CACHED);
+    return ptr;
+}
+
+/* return 1 if cached, 0 if ptr should go to the pool, -1 if already cached */
+static int tcache_free(struct dt_mm_pool *pool, uint8_t *ptr)
+{
+    mm_block_t *block = (mm_block_t *)(ptr - BLOCK_HDR_SIZE);
+    mm_block_t *next;
+    struct mm_tcache *tc;
+    size_t size;
+    int c, cap;
 
-    ret = 0;
-    if (item_free) {
-        item_free->ptr = item_use->ptr;
-        item_free->size += item_use->size;
-        fl->size += item_use->size;
-        free(item_use);
-        dt_info(TAG, "free %p memory size:%d ok \n", ptr, item_use->size);
-        goto end;
+    /*
+     * prev_phys may change under other threads, the full check runs on flush
+     * the next block links back to a used block until that block is freed
+     */
+    size = block_size(block);
+    if (ptr < pool->mem + BLOCK_HDR_SIZE || ptr >= pool->end
+        || (size_t)(ptr - pool->mem) % BLOCK_ALIGN || block_is_free(block)
+        || size < BLOCK_MIN_SIZE || size % BLOCK_ALIGN || size > (size_t)(pool->end - ptr)) {
+        return 0;
+    }
+    next = block_next(pool, block);
+    if (next ? next->prev_phys != block : ptr + size != pool->end) {
+        return 0;
+    }
+    c = tcache_class(size);
+    if (c >= TCACHE_CLASS_COUNT || !(tc = tcache_get(pool))) {
+        return 0;
+    }
+    // the cached bit makes a second free of a parked block fail
+    if (dt_atomic_fetch_or(&block->size, BLOCK_CACHED) & BLOCK_CACHED) {
+        return -1;
+    }
+    cap = tcache_cap(size);
+    if (tc->count[c] >= cap) {
+        tcache_flush(pool, tc, c, cap / 2);
     }
+    tc->slot[c][tc->count[c]++] = ptr;
+    return 1;
+}
+
+/* call before first touch, otherwise pages are already placed */
+static int mm_pool_bind(uint8_t *mem, size_t len, int node)
+{
+#if defined(__NR_mbind)
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))];
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    return (int)syscall(__NR_mbind, mem, len, MM_MPOL_BIND, mask, sizeof(mask) * 8, 0);
+#else
+    return -1;
+#endif
+}
 
-    INIT_LIST_HEAD(&item_use->list);
-    list_add(&item_use->list, &fl->list);
-    fl->count++;
-    fl->size += item_use->size;
-    dt_info(TAG, "free %p memory size:%d ok \n", ptr, item_use->size);
+static uint8_t *mm_pool_map(struct dt_mm_pool *pool, int64_t size)
+{
+    int flags = pool->flags;
+    int mflags = MAP_PRIVATE | MAP_ANONYMOUS;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t len = ((size_t)size + page - 1) & ~(size_t)(page - 1);
+    uint8_t *mem = MAP_FAILED;
+    size_t i;
 
-end:
-    // second check - maybe free list can merge to one item
-    if (ret == 0) {
-        struct mm_item *header = list_first_entry(&fl->list, struct mm_item, list);
-        struct mm_item *next = list_entry(header->list.next, struct mm_item, list);
-        if (next && (header->ptr + header->size == next->ptr)) {
-            header->size += next->size;
-            list_del(&next->list);
-            fl->count--;
-            free(next);
+#if defined(MAP_HUGETLB)
+    if (flags & DT_MM_POOL_HUGETLB) {
+        size_t hlen = ((size_t)size + MM_HUGE_PAGE_SIZE - 1) & ~(size_t)(MM_HUGE_PAGE_SIZE - 1);
+        mem = mmap(NULL, hlen, PROT_READ | PROT_WRITE, mflags | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            len = hlen;
+        } else {
+            dt_warning(TAG, "MAP_HUGETLB failed, fall back to transparent huge pages\n");
+            flags |= DT_MM_POOL_HUGEPAGE;
         }
     }
-    dt_unlock(&pool->mutex);
+#endif
+    if (mem == MAP_FAILED) {
+        // populate here only when no numa binding has to come first
+        if ((flags & DT_MM_POOL_POPULATE) && !(flags & DT_MM_POOL_NUMA) && !(flags & DT_MM_POOL_HUGEPAGE)) {
+            mflags |= MAP_POPULATE;
+            flags &= ~DT_MM_POOL_POPULATE;
+        }
+        mem = mmap(NULL, len, PROT_READ | PROT_WRITE, mflags, -1, 0);
+        if (mem == MAP_FAILED) {
+            return NULL;
+        }
+    }
+#if defined(MADV_HUGEPAGE)
+    if ((flags & DT_MM_POOL_HUGEPAGE) && madvise(mem, len, MADV_HUGEPAGE) < 0) {
+        dt_warning(TAG, "MADV_HUGEPAGE failed\n");
+    }
+#endif
+    if ((flags & DT_MM_POOL_NUMA) && mm_pool_bind(mem, len, (pool->flags >> 16) & 0xff) < 0) {
+        dt_warning(TAG, "mbind to node %d failed\n", (pool->flags >> 16) & 0xff);
+    }
+    if (flags & DT_MM_POOL_POPULATE) {
+        for (i = 0; i < len; i += page) {
+            mem[i] = 0;
+        }
+    }
+    pool->map_size = len;
+    return mem;
+}
+
+static void mm_pool_unmap(struct dt_mm_pool *pool)
+{
+    if (pool->map_size) {
+        munmap(pool->mem, pool->map_size);
+    } else {
+        free(pool->mem);
+    }
+}
+
+struct dt_mm_pool *dt_mm_pool_create(int64_t size)
+{
+    return dt_mm_pool_create2(size, 0);
+}
+
+struct dt_mm_pool *dt_mm_pool_create2(int64_t size, int flags)
+{
+    struct dt_mm_pool *pool = (struct dt_mm_pool *)malloc(sizeof(struct dt_mm_pool));
+    if (!pool) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(struct dt_mm_pool));
+    pool->flags = flags;
+    if (flags & MM_MAP_FLAGS) {
+        pool->mem = mm_pool_map(pool, size);
+    } else {
+        pool->mem = (uint8_t *)malloc(size);
+    }
+    if (!pool->mem) {
+        free(pool);
+        return NULL;
+    }
+    pool->size = size;
+    if (block_pool_init(pool) < 0) {
+        mm_pool_unmap(pool);
+        free(pool);
+        return NULL;
+    }
+    if ((flags & DT_MM_POOL_THREAD_CACHE) && pthread_key_create(&pool->tcache_key, tcache_destroy) != 0) {
+        pool->flags &= ~DT_MM_POOL_THREAD_CACHE;
+    }
+    dt_lock_init(&pool->mutex, NULL);
+    return pool;
+}
+
+uint8_t *dt_mm_pool_alloc(struct dt_mm_pool *pool, int size)
+{
+    uint8_t *palloc = NULL;
+    if ((pool->flags & DT_MM_POOL_THREAD_CACHE) && size <= TCACHE_MAX_SIZE) {
+        palloc = tcache_alloc(pool, size);
+    } else {
+        dt_lock(&pool->mutex);
+        palloc = block_alloc(pool, size);
+        dt_unlock(&pool->mutex);
+    }
+    if (palloc) {
+        DT_LOGD(TAG, "alloc %d memory at:%p ok \n", size, palloc);
+    }
+    return palloc;
+}
+
+int dt_mm_pool_free(struct dt_mm_pool *pool, uint8_t *ptr)
+{
+    int ret = 0;
+    if (pool->flags & DT_MM_POOL_THREAD_CACHE) {
+        ret = tcache_free(pool, ptr);
+    }
+    if (ret) {
+        ret = ret > 0 ? 0 : -1;
+    } else {
+        dt_lock(&pool->mutex);
+        ret = block_free(pool, ptr);
+        dt_unlock(&pool->mutex);
+    }
+    if (ret == 0) {
+        DT_LOGD(TAG, "free %p memory ok \n", ptr);
+    }
     return ret;
 }
 
 void dt_mm_pool_destroy(struct dt_mm_pool *pool)
 {
-    struct mm_list *ul = &pool->mluse;
-    struct mm_list *fl = &pool->mlfree;
-    struct mm_item *item_use;
-    struct mm_item *item_free;
-    struct list_head *list1, *list2;
-
-    // Free item use
-    list_for_each_safe(list1, list2, &ul->list) {
-        item_use = list_entry(list1, struct mm_item, list);
-        if (item_use) {
-            free(item_use);
+    if (pool->flags & DT_MM_POOL_THREAD_CACHE) {
+        // no destructor runs after key delete, drop caches of live threads here
+        pthread_key_delete(pool->tcache_key);
+        dt_lock(&tcache_lock);
+        while (pool->tcache) {
+            struct mm_tcache *tc = pool->tcache;
+            pool->tcache = tc->next;
+            free(tc);
         }
+        dt_unlock(&tcache_lock);
     }
+    mm_pool_unmap(pool);
+    free(pool);
+    return;
+}
+
+/* call with mutex held */
+static void pool_stat_locked(struct dt_mm_pool *pool, struct dt_mm_pool_stat *stat)
+{
+    mm_block_t *block;
+    size_t largest = 0;
+    int i, j;
 
-    // Free item free
-    list_for_each_safe(list1, list2, &fl->list) {
-        item_free = list_entry(list1, struct mm_item, list);
-        if (item_free) {
-            free(item_free);
+    for (i = 0; i < BIN_FL_COUNT; i++) {
+        for (j = 0; j < BIN_SL_COUNT; j++) {
+            for (block = pool->bins[i][j]; block; block = block->next_free) {
+                largest = DT_MAX(largest, block_size(block));
+            }
         }
     }
+    stat->size = pool->end - pool->mem;
+    stat->use_size = pool->mluse.size;
+    stat->free_size = pool->mlfree.size;
+    stat->largest_free = largest;
+    stat->use_count = pool->mluse.count;
+    stat->free_count = pool->mlfree.count;
+}
 
-    if (pool->mem) {
-        free(pool);
+int dt_mm_pool_get_stat(struct dt_mm_pool *pool, struct dt_mm_pool_stat *stat)
+{
+    if (!pool || !stat) {
+        return -1;
     }
-    return;
+    dt_lock(&pool->mutex);
+    pool_stat_locked(pool, stat);
+    dt_unlock(&pool->mutex);
+    return 0;
 }
 
 void dt_mm_pool_dump(struct dt_mm_pool *pool)
@@ -227,14 +690,23 @@ void dt_mm_pool_dump(struct dt_mm_pool *pool)
     if (!pool) {
         return;
     }
-    struct mm_list *ul = &pool->mluse;
-    struct mm_list *fl = &pool->mlfree;
+    struct dt_mm_pool_stat stat;
+
+    dt_lock(&pool->mutex);
+    pool_stat_locked(pool, &stat);
     dt_info(TAG, "====================================\n");
-    dt_info(TAG, "pool total mm:%lld \n", pool->size);
+    dt_info(TAG, "pool total mm:%lld mode:%s%s backing:%s\n", pool->size,
+            (pool->flags & DT_MM_POOL_SIZE_CLASS) ? "size-class" : "first-fit",
+            (pool->flags & DT_MM_POOL_THREAD_CACHE) ? " thread-cache" : "",
+            pool->map_size ? "mmap" : "malloc");
     dt_info(TAG, "mm use list\n");
-    dt_info(TAG, "count:%d size:%lld\n", ul->count, ul->size);
+    dt_info(TAG, "count:%d size:%lld\n", stat.use_count, stat.use_size);
     dt_info(TAG, "mm free list\n");
-    dt_info(TAG, "count:%d size:%lld\n", fl->count, fl->size);
+    dt_info(TAG, "count:%d size:%lld\n", stat.free_count, stat.free_size);
+    // 0: all free memory in one block, near 1: free memory scattered
+    dt_info(TAG, "largest free:%lld fragmentation:%.3f\n", stat.largest_free,
+            stat.free_size > 0 ? 1.0 - (double)stat.largest_free / stat.free_size : 0.0);
     dt_info(TAG, "====================================\n");
+    dt_unlock(&pool->mutex);
     return;
 }
@@ -0,0 +1,212 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_mpmc.c
+ *    Description:  bounded multi-producer/multi-consumer queue
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+/*
+ * slot state is encoded in cell->seq, for position pos:
+ *   seq == pos             slot free, producer of pos may write
+ *   seq == pos + 1         slot full, consumer of pos may read
+ *   seq == pos + capacity  slot free again for next lap
+ * producers/consumers claim positions by cas on enqueue_pos/dequeue_pos,
+ * then own the slot until they publish the new seq with release
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+
+#include "dt_atomic.h"
+#include "dt_macro.h"
+#include "dt_mpmc.h"
+
+#define SPIN_COUNT 64
+
+typedef struct {
+    size_t seq;
+    void *data;
+} mpmc_cell_t;
+
+struct dt_mpmc_queue {
+    mpmc_cell_t *cells;
+    size_t mask;
+    uint8_t pad0[DT_CACHELINE_SIZE];
+    size_t enqueue_pos;
+    uint8_t pad1[DT_CACHELINE_SIZE - sizeof(size_t)];
+    size_t dequeue_pos;
+    uint8_t pad2[DT_CACHELINE_SIZE - sizeof(size_t)];
+};
+
+dt_mpmc_queue_t *dt_mpmc_queue_new(uint32_t capacity)
+{
+    dt_mpmc_queue_t *q;
+    size_t size = 2;
+    size_t i;
+
+    if (capacity > (1U << 30)) {
+        return NULL;
+    }
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    q = (dt_mpmc_queue_t *)malloc(sizeof(dt_mpmc_queue_t));
+    if (!q) {
+        return NULL;
+    }
+    q->cells = (mpmc_cell_t *)malloc(size * sizeof(mpmc_cell_t));
+    if (!q->cells) {
+        free(q);
+        return NULL;
+    }
+    for (i = 0; i < size; i++) {
+        q->cells[i].seq = i;
+        q->cells[i].data = NULL;
+    }
+    q->mask = size - 1;
+    q->enqueue_pos = 0;
+    q->dequeue_pos = 0;
+    return q;
+}
+
+void dt_mpmc_queue_free(dt_mpmc_queue_t *q)
+{
+    if (!q) {
+        return;
+    }
+    free(q->cells);
+    free(q);
+}
+
+uint32_t dt_mpmc_queue_capacity(dt_mpmc_queue_t *q)
+{
+    return (uint32_t)(q->mask + 1);
+}
+
+uint32_t dt_mpmc_queue_length(dt_mpmc_queue_t *q)
+{
+    size_t deq = dt_atomic_load_acquire(&q->dequeue_pos);
+    size_t enq = dt_atomic_load_acquire(&q->enqueue_pos);
+    intptr_t len = (intptr_t)(enq - deq);
+    if (len < 0) {
+        return 0;
+    }
+    return (uint32_t)DT_MIN((size_t)len, q->mask + 1);
+}
+
+/*
+ * claim up to n slots starting at *pos
+ * ready: cell seq equals pos + i + expect for a claimable slot
+ * return number of claimed slots, 0 if none ready
+ */
+static int mpmc_claim(dt_mpmc_queue_t *q, size_t *posp, size_t *pos, int n, size_t expect)
+{
+    size_t cur = dt_atomic_load(posp);
+    for (;;) {
+        int count = 0;
+        intptr_t dif = 0;
+        while (count < n) {
+            mpmc_cell_t *cell = &q->cells[(cur + count) & q->mask];
+            size_t seq = dt_atomic_load_acquire(&cell->seq);
+            dif = (intptr_t)(seq - (cur + count + expect));
+            if (dif != 0) {
+                break;
+            }
+            count++;
+        }
+        if (count == 0) {
+            if (dif < 0) {
+                return 0;       // full (push) or empty (pop)
+            }
+            cur = dt_atomic_load(posp);     // someone else claimed it, reload
+            continue;
+        }
+        if (dt_atomic_cas_weak(posp, &cur, cur + count)) {
+            *pos = cur;
+            return count;
+        }
+    }
+}
+
+int dt_mpmc_try_push_n(dt_mpmc_queue_t *q, void **data, int n)
+{
+    size_t pos;
+    int i, count;
+
+    if (n <= 0) {
+        return 0;
+    }
+    count = mpmc_claim(q, &q->enqueue_pos, &pos, n, 0);
+    for (i = 0; i < count; i++) {
+        mpmc_cell_t *cell = &q->cells[(pos + i) & q->mask];
+        cell->data = data[i];
+        dt_atomic_store_release(&cell->seq, pos + i + 1);
+    }
+    return count;
+}
+
+int dt_mpmc_try_pop_n(dt_mpmc_queue_t *q, void **data, int n)
+{
+    size_t pos;
+    int i, count;
+
+    if (n <= 0) {
+        return 0;
+    }
+    count = mpmc_claim(q, &q->dequeue_pos, &pos, n, 1);
+    for (i = 0; i < count; i++) {
+        mpmc_cell_t *cell = &q->cells[(pos + i) & q->mask];
+        data[i] = cell->data;
+        dt_atomic_store_release(&cell->seq, pos + i + q->mask + 1);
+    }
+    return count;
+}
+
+int dt_mpmc_try_push(dt_mpmc_queue_t *q, void *data)
+{
+    return dt_mpmc_try_push_n(q, &data, 1) == 1 ? 0 : -1;
+}
+
+int dt_mpmc_try_pop(dt_mpmc_queue_t *q, void **data)
+{
+    return dt_mpmc_try_pop_n(q, data, 1) == 1 ? 0 : -1;
+}
+
+static void mpmc_backoff(int *spin)
+{
+    if (*spin < SPIN_COUNT) {
+        (*spin)++;
+        dt_cpu_relax();
+    } else {
+        sched_yield();
+    }
+}
+
+void dt_mpmc_push(dt_mpmc_queue_t *q, void *data)
+{
+    int spin = 0;
+    while (dt_mpmc_try_push(q, data) < 0) {
+        mpmc_backoff(&spin);
+    }
+}
+
+void *dt_mpmc_pop(dt_mpmc_queue_t *q)
+{
+    void *data = NULL;
+    int spin = 0;
+    while (dt_mpmc_try_pop(q, &data) < 0) {
+        mpmc_backoff(&spin);
+    }
+    return data;
+}
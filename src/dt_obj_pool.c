@@ -0,0 +1,264 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_obj_pool.c
+ *    Description:  fixed-size object pool
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+/*
+ * objects are addressed by a global index, chunk k covers indices
+ * [count * (2^k - 1), count * (2^(k+1) - 1)), so index -> chunk is one clz.
+ * freelist head packs (tag << 32) | (index + 1), the tag changes on every
+ * update so a stale cas fails (ABA). a free object keeps index + 1 of the
+ * next free object in its first 4 bytes, 0 ends the list.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dt_atomic.h"
+#include "dt_lock.h"
+#include "dt_log.h"
+#include "dt_obj_pool.h"
+
+#define TAG "OBJ_POOL"
+
+#define OBJ_POOL_MAX_CHUNKS 32
+
+struct dt_obj_pool {
+    uint64_t head;
+    uint8_t pad[DT_CACHELINE_SIZE - sizeof(uint64_t)];
+
+    size_t stride;
+    int size;
+    int align;
+    int count;
+    int flags;
+    struct dt_mm_pool *mm;
+
+    int nchunks;
+    uint32_t capacity;
+    uint8_t *chunk[OBJ_POOL_MAX_CHUNKS];        // aligned base
+    uint8_t *chunk_raw[OBJ_POOL_MAX_CHUNKS];    // as allocated
+    uint32_t chunk_first[OBJ_POOL_MAX_CHUNKS];
+    uint32_t chunk_count[OBJ_POOL_MAX_CHUNKS];
+
+    dt_lock_t mutex;        // grow, and get/put without DT_OBJ_POOL_LOCKFREE
+};
+
+static inline uint8_t *obj_at(dt_obj_pool_t *pool, uint32_t idx)
+{
+    int k = 31 - __builtin_clz(idx / pool->count + 1);
+    return pool->chunk[k] + (size_t)(idx - pool->chunk_first[k]) * pool->stride;
+}
+
+static int obj_index(dt_obj_pool_t *pool, uint8_t *obj, uint32_t *idx)
+{
+    int k, n = dt_atomic_load_acquire(&pool->nchunks);
+    for (k = 0; k < n; k++) {
+        uint8_t *base = pool->chunk[k];
+        if (obj >= base && obj < base + (size_t)pool->chunk_count[k] * pool->stride) {
+            if ((size_t)(obj - base) % pool->stride) {
+                return -1;
+            }
+            *idx = pool->chunk_first[k] + (uint32_t)((size_t)(obj - base) / pool->stride);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static inline uint64_t head_make(uint64_t old, uint32_t idx1)
+{
+    return (((old >> 32) + 1) << 32) | idx1;
+}
+
+static uint8_t *freelist_pop(dt_obj_pool_t *pool)
+{
+    uint64_t head = dt_atomic_load_acquire(&pool->head);
+    uint64_t next;
+    uint8_t *obj;
+
+    do {
+        uint32_t idx1 = (uint32_t)head;
+        if (!idx1) {
+            return NULL;
+        }
+        obj = obj_at(pool, idx1 - 1);
+        // obj may be handed out meanwhile, then the cas fails on the tag
+        next = head_make(head, dt_atomic_load((uint32_t *)obj));
+    } while (!dt_atomic_cas_weak(&pool->head, &head, next));
+    return obj;
+}
+
+/* push objects first..last already linked through their first 4 bytes */
+static void freelist_push(dt_obj_pool_t *pool, uint32_t first, uint8_t *last)
+{
+    uint64_t head = dt_atomic_load(&pool->head);
+    uint64_t next;
+
+    do {
+        dt_atomic_store((uint32_t *)last, (uint32_t)head);
+        next = head_make(head, first + 1);
+    } while (!dt_atomic_cas_weak(&pool->head, &head, next));
+}
+
+/* call with mutex held */
+static int obj_pool_grow(dt_obj_pool_t *pool)
+{
+    int k = pool->nchunks;
+    uint32_t n = (uint32_t)pool->count << k;
+    size_t bytes;
+    uint8_t *raw, *base;
+    uint32_t i;
+
+    if (k == OBJ_POOL_MAX_CHUNKS || (k > 0 && !(pool->flags & DT_OBJ_POOL_GROW))
+        || (uint64_t)pool->capacity + n >= 0xffffffffULL) {
+        return -1;
+    }
+    bytes = (size_t)n * pool->stride + pool->align - 1;
+    if (pool->mm) {
+        raw = bytes <= 0x7fffffff ? dt_mm_pool_alloc(pool->mm, (int)bytes) : NULL;
+    } else {
+        raw = (uint8_t *)malloc(bytes);
+    }
+    if (!raw) {
+        dt_error(TAG, "chunk alloc failed, %u objects\n", n);
+        return -1;
+    }
+    base = (uint8_t *)(((uintptr_t)raw + pool->align - 1) & ~(uintptr_t)(pool->align - 1));
+    for (i = 0; i + 1 < n; i++) {
+        *(uint32_t *)(base + (size_t)i * pool->stride) = pool->capacity + i + 2;
+    }
+
+    pool->chunk_raw[k] = raw;
+    pool->chunk[k] = base;
+    pool->chunk_first[k] = pool->capacity;
+    pool->chunk_count[k] = n;
+    dt_atomic_store_release(&pool->nchunks, k + 1);
+    freelist_push(pool, pool->capacity, base + (size_t)(n - 1) * pool->stride);
+    pool->capacity += n;
+    return 0;
+}
+
+dt_obj_pool_t *dt_obj_pool_create(int size, int align, int count, int flags)
+{
+    return dt_obj_pool_create2(NULL, size, align, count, flags);
+}
+
+dt_obj_pool_t *dt_obj_pool_create2(struct dt_mm_pool *mm, int size, int align, int count, int flags)
+{
+    dt_obj_pool_t *pool;
+
+    if (align <= 0) {
+        align = sizeof(void *);
+    }
+    if (size <= 0 || count <= 0 || (align & (align - 1))) {
+        dt_error(TAG, "invalid size:%d align:%d count:%d\n", size, align, count);
+        return NULL;
+    }
+    // room and alignment for the freelist link
+    align = align < (int)sizeof(uint32_t) ? (int)sizeof(uint32_t) : align;
+    size = size < (int)sizeof(uint32_t) ? (int)sizeof(uint32_t) : size;
+
+    pool = (dt_obj_pool_t *)malloc(sizeof(dt_obj_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(dt_obj_pool_t));
+    pool->size = size;
+    pool->align = align;
+    pool->stride = ((size_t)size + align - 1) & ~(size_t)(align - 1);
+    pool->count = count;
+    pool->flags = flags;
+    pool->mm = mm;
+    dt_lock_init(&pool->mutex, NULL);
+    if (obj_pool_grow(pool) < 0) {
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void *dt_obj_pool_get(dt_obj_pool_t *pool)
+{
+    uint8_t *obj;
+    int lockfree = pool->flags & DT_OBJ_POOL_LOCKFREE;
+
+    if (!lockfree) {
+        dt_lock(&pool->mutex);
+    }
+    obj = freelist_pop(pool);
+    while (!obj && (pool->flags & DT_OBJ_POOL_GROW)) {
+        int ret;
+        if (lockfree) {
+            dt_lock(&pool->mutex);
+        }
+        // another thread may have grown or put meanwhile
+        obj = freelist_pop(pool);
+        ret = obj ? 0 : obj_pool_grow(pool);
+        if (lockfree) {
+            dt_unlock(&pool->mutex);
+        }
+        if (obj || ret < 0) {
+            break;
+        }
+        obj = freelist_pop(pool);
+    }
+    if (!lockfree) {
+        dt_unlock(&pool->mutex);
+    }
+    return obj;
+}
+
+int dt_obj_pool_put(dt_obj_pool_t *pool, void *obj)
+{
+    uint32_t idx;
+
+    if (!obj || obj_index(pool, (uint8_t *)obj, &idx) < 0) {
+        dt_error(TAG, "put %p not from pool\n", obj);
+        return -1;
+    }
+    if (pool->flags & DT_OBJ_POOL_LOCKFREE) {
+        freelist_push(pool, idx, (uint8_t *)obj);
+        return 0;
+    }
+    dt_lock(&pool->mutex);
+    freelist_push(pool, idx, (uint8_t *)obj);
+    dt_unlock(&pool->mutex);
+    return 0;
+}
+
+int dt_obj_pool_capacity(dt_obj_pool_t *pool)
+{
+    int capacity;
+    dt_lock(&pool->mutex);
+    capacity = (int)pool->capacity;
+    dt_unlock(&pool->mutex);
+    return capacity;
+}
+
+void dt_obj_pool_destroy(dt_obj_pool_t *pool)
+{
+    int k;
+    if (!pool) {
+        return;
+    }
+    for (k = 0; k < pool->nchunks; k++) {
+        if (pool->mm) {
+            dt_mm_pool_free(pool->mm, pool->chunk_raw[k]);
+        } else {
+            free(pool->chunk_raw[k]);
+        }
+    }
+    free(pool);
+}
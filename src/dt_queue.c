@@ -22,55 +22,146 @@ static void unlock_queue(dt_queue_t * qu)
     pthread_mutex_unlock(&qu->mutex);
 }
 
-#if 0
-static int wakeup_on_queue(dt_queue_t * qu)
+/*
+ * node cache, call with queue locked
+ */
+static _node_t *node_get(dt_queue_t * qu)
 {
-    if (unlikely(NULL == qu)) {
-        return -1;
+    _node_t *node = qu->free_nodes;
+    if (node) {
+        qu->free_nodes = node->next;
+        qu->free_count--;
+        qu->node_reuse++;
+        return node;
+    }
+    qu->node_alloc++;
+    return (_node_t *) malloc(sizeof(_node_t));
+}
+
+static void node_put(dt_queue_t * qu, _node_t * node)
+{
+    if (qu->free_count >= qu->free_max) {
+        free(node);
+        return;
     }
-    return pthread_cond_broadcast(&qu->cond);
+    node->next = qu->free_nodes;
+    qu->free_nodes = node;
+    qu->free_count++;
 }
 
-int wait_on_queue(dt_queue_t * qu)
+static void node_cache_trim(dt_queue_t * qu, uint32_t max)
 {
-    if (unlikely(NULL == qu)) {
-        return -1;
+    _node_t *node;
+    while (qu->free_count > max) {
+        node = qu->free_nodes;
+        qu->free_nodes = node->next;
+        qu->free_count--;
+        free(node);
     }
+}
 
-    pthread_cond_wait(&qu->cond, &qu->mutex);
-    pthread_mutex_unlock(&qu->mutex);
-    return 0;
+/*
+ * wakeup helpers, call with queue locked
+ * skip the syscall when nobody waits
+ */
+static void wakeup_on_queue(dt_queue_t * qu, uint32_t pushed)
+{
+    if (qu->waiters > 0) {
+        // one node feeds one consumer, waking the rest only makes them sleep again
+        if (pushed == 1) {
+            pthread_cond_signal(&qu->cond);
+        } else {
+            pthread_cond_broadcast(&qu->cond);
+        }
+    }
 }
 
-/* timeout unit : millisecond */
-int wait_on_dt_queue_timeout(dt_queue_t * qu, int timeout)
+static void wakeup_on_queue_space(dt_queue_t * qu)
 {
-    if (unlikely(NULL == qu)) {
-        return -1;
+    if (qu->space_waiters > 0) {
+        pthread_cond_broadcast(&qu->cond_space);
     }
+}
 
-    if (0 == timeout) {
-        pthread_cond_wait(&qu->cond, &qu->mutex);
-        pthread_mutex_unlock(&qu->mutex);
-    } else {
-        struct timespec abstime;
-        struct timeval tv;
-        long s;
+/* cond uses CLOCK_MONOTONIC, see dt_queue_new */
+static void get_abstime(struct timespec *abstime, int timeout)
+{
+    clock_gettime(CLOCK_MONOTONIC, abstime);
+    abstime->tv_sec += timeout / 1000;
+    abstime->tv_nsec += (long)(timeout % 1000) * 1000000;
+    if (abstime->tv_nsec >= 1000000000) {
+        abstime->tv_sec++;
+        abstime->tv_nsec -= 1000000000;
+    }
+}
 
-        gettimeofday(&tv, NULL);
-        s = timeout * 1000 + tv.tv_usec;
-        tv.tv_sec += s / 1000000;
-        tv.tv_usec = s % 1000000;
+/*
+ * wait with queue locked until data is available
+ * return 0 if data available, -1 on timeout
+ */
+static int wait_data_locked(dt_queue_t * qu, int timeout)
+{
+    struct timespec abstime;
+    int ret = 0;
+
+    if (timeout > 0) {
+        get_abstime(&abstime, timeout);
+    }
+    qu->waiters++;
+    while (NULL == qu->head && ret == 0) {
+        if (timeout > 0) {
+            ret = pthread_cond_timedwait(&qu->cond, &qu->mutex, &abstime);
+        } else {
+            ret = pthread_cond_wait(&qu->cond, &qu->mutex);
+        }
+    }
+    qu->waiters--;
+    return qu->head ? 0 : -1;
+}
 
-        abstime.tv_sec = tv.tv_sec;
-        abstime.tv_nsec = tv.tv_usec * 1000;
+/*
+ * wait with queue locked until queue below max_length
+ * return 0 if space available, -1 on timeout
+ */
+static int wait_space_locked(dt_queue_t * qu, int timeout)
+{
+    struct timespec abstime;
+    int ret = 0;
+
+    if (timeout > 0) {
+        get_abstime(&abstime, timeout);
+    }
+    qu->space_waiters++;
+    while (qu->max_length && qu->length >= qu->max_length && ret == 0) {
+        if (timeout > 0) {
+            ret = pthread_cond_timedwait(&qu->cond_space, &qu->mutex, &abstime);
+        } else {
+            ret = pthread_cond_wait(&qu->cond_space, &qu->mutex);
+        }
+    }
+    qu->space_waiters--;
+    return (qu->max_length && qu->length >= qu->max_length) ? -1 : 0;
+}
+
+int wait_on_queue(dt_queue_t * qu)
+{
+    return wait_on_dt_queue_timeout(qu, 0);
+}
 
-        pthread_cond_timedwait(&qu->cond, &qu->mutex, &abstime);
-        pthread_mutex_unlock(&qu->mutex);
+/* timeout unit : millisecond */
+int wait_on_dt_queue_timeout(dt_queue_t * qu, int timeout)
+{
+    int ret;
+
+    if (unlikely(NULL == qu)) {
+        return -1;
     }
-    return 0;
+
+    lock_queue(qu);
+    ret = wait_data_locked(qu, timeout);
+    unlock_queue(qu);
+    return ret;
 }
-#endif
 
 /**
  * @brief create a queue
@@ -78,11 +169,25 @@ int wait_on_dt_queue_timeout(dt_queue_t * qu, int timeout)
  */
 dt_queue_t *dt_queue_new(void)
 {
+    pthread_condattr_t attr;
     dt_queue_t *q = (dt_queue_t *) malloc(sizeof(dt_queue_t));
+    if (unlikely(NULL == q)) {
+        return NULL;
+    }
     q->head = q->tail = NULL;
     q->length = 0;
+    q->max_length = 0;
+    q->waiters = q->space_waiters = 0;
+    q->free_nodes = NULL;
+    q->free_count = 0;
+    q->free_max = DT_QUEUE_NODE_CACHE_DEFAULT;
+    q->node_alloc = q->node_reuse = 0;
     pthread_mutex_init(&q->mutex, NULL);
-    //pthread_cond_init(&q->cond,NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->cond, &attr);
+    pthread_cond_init(&q->cond_space, &attr);
+    pthread_condattr_destroy(&attr);
     return q;
 }
 
@@ -104,8 +209,10 @@ void dt_queue_free(dt_queue_t * qu, free_func func)
         free(data);
     }
 
+    node_cache_trim(qu, 0);
     pthread_mutex_destroy(&qu->mutex);
-    //pthread_cond_destroy(&qu->cond);
+    pthread_cond_destroy(&qu->cond);
+    pthread_cond_destroy(&qu->cond_space);
 
     free(qu);
 }
@@ -126,6 +233,53 @@ void dt_queue_flush(dt_queue_t * qu, free_func func)
     }
 }
 
+/**
+ * @brief set capacity used by dt_queue_push_tail_timeout
+ * @param qu         queue
+ * @param max_length max node count, 0 for unbounded
+ */
+void dt_queue_set_max_length(dt_queue_t * qu, uint32_t max_length)
+{
+    if (unlikely(NULL == qu)) {
+        return;
+    }
+    lock_queue(qu);
+    qu->max_length = max_length;
+    wakeup_on_queue_space(qu);
+    unlock_queue(qu);
+}
+
+/**
+ * @brief set node cache high-water mark
+ * @param qu    queue
+ * @param max   max cached node count, 0 to disable
+ */
+void dt_queue_set_node_cache(dt_queue_t * qu, uint32_t max)
+{
+    if (unlikely(NULL == qu)) {
+        return;
+    }
+    lock_queue(qu);
+    qu->free_max = max;
+    node_cache_trim(qu, max);
+    unlock_queue(qu);
+}
+
+/**
+ * @brief get node allocation counters
+ */
+void dt_queue_get_stats(dt_queue_t * qu, dt_queue_stats_t * stats)
+{
+    if (unlikely(NULL == qu) || unlikely(NULL == stats)) {
+        return;
+    }
+    lock_queue(qu);
+    stats->node_alloc = qu->node_alloc;
+    stats->node_reuse = qu->node_reuse;
+    stats->node_cached = qu->free_count;
+    unlock_queue(qu);
+}
+
 /**
  * @brief get length of queue
  */
@@ -151,7 +305,7 @@ void dt_queue_push_head(dt_queue_t * qu, void *data)
     }
 
     lock_queue(qu);
-    node = (_node_t *) malloc(sizeof(_node_t));
+    node = node_get(qu);
     node->data = data;
     node->next = qu->head;
     node->prev = NULL;
@@ -164,8 +318,26 @@ void dt_queue_push_head(dt_queue_t * qu, void *data)
         qu->tail = qu->head;
     }
     qu->length++;
+    wakeup_on_queue(qu, 1);
     unlock_queue(qu);
-    //wakeup_on_queue(qu);
+}
+
+static void push_tail_locked(dt_queue_t * qu, void *data)
+{
+    _node_t *node = node_get(qu);
+    node->data = data;
+    node->next = NULL;
+    node->prev = qu->tail;
+
+    if (qu->tail) {
+        qu->tail->next = node;
+    }
+    qu->tail = node;
+    if (NULL == qu->head) {
+        qu->head = qu->tail;
+    }
+    qu->length++;
+    //printf("queue in length:%d \n",qu->length);
 }
 
 /**
@@ -175,29 +347,63 @@ void dt_queue_push_head(dt_queue_t * qu, void *data)
  */
 void dt_queue_push_tail(dt_queue_t * qu, void *data)
 {
-    _node_t *node = NULL;
-
     if (unlikely(NULL == qu)) {
         return;
     }
 
     lock_queue(qu);
-    node = (_node_t *) malloc(sizeof(_node_t));
-    node->data = data;
-    node->next = NULL;
-    node->prev = qu->tail;
+    push_tail_locked(qu, data);
+    wakeup_on_queue(qu, 1);
+    unlock_queue(qu);
+}
 
-    if (qu->tail) {
-        qu->tail->next = node;
+/**
+ * @brief push n data at tail of queue under one lock
+ * @param qu    queue
+ * @param data  array of node data
+ * @param n     data count
+ * @return  number of data pushed
+ */
+int dt_queue_push_tail_n(dt_queue_t * qu, void **data, int n)
+{
+    int i;
+
+    if (unlikely(NULL == qu) || n <= 0) {
+        return 0;
     }
-    qu->tail = node;
-    if (NULL == qu->head) {
-        qu->head = qu->tail;
+
+    lock_queue(qu);
+    for (i = 0; i < n; i++) {
+        push_tail_locked(qu, data[i]);
     }
-    qu->length++;
-    //printf("queue in length:%d \n",qu->length);
+    wakeup_on_queue(qu, n);
     unlock_queue(qu);
-    //wakeup_on_queue(qu);
+    return n;
+}
+
+/**
+ * @brief push tail of queue, wait while queue is full
+ * @param qu      queue
+ * @param data    node data
+ * @param timeout millisecond, <= 0 wait forever
+ * @return 0 for success, -1 on timeout
+ */
+int dt_queue_push_tail_timeout(dt_queue_t * qu, void *data, int timeout)
+{
+    int ret;
+
+    if (unlikely(NULL == qu)) {
+        return -1;
+    }
+
+    lock_queue(qu);
+    ret = wait_space_locked(qu, timeout);
+    if (ret == 0) {
+        push_tail_locked(qu, data);
+        wakeup_on_queue(qu, 1);
+    }
+    unlock_queue(qu);
+    return ret;
 }
 
 /**
@@ -223,7 +429,7 @@ void dt_queue_push_nth(dt_queue_t * qu, void *data, uint32_t n)
         return dt_queue_push_head(qu, data);
     }
 
-    node = (_node_t *) malloc(sizeof(_node_t));
+    node = node_get(qu);
     node->data = data;
 
     p = get_node_link_nth(qu, n - 1);
@@ -234,24 +440,18 @@ void dt_queue_push_nth(dt_queue_t * qu, void *data, uint32_t n)
     node->next->prev = node;
 
     qu->length++;
+    wakeup_on_queue(qu, 1);
 
     unlock_queue(qu);
-    //wakeup_on_queue(qu);
 }
 
-/**
- * @brief pop data at the head of queue
- * @param qu    queue
- * @return  queue node data
- */
-void *dt_queue_pop_head(dt_queue_t * qu)
+static void *pop_head_locked(dt_queue_t * qu)
 {
     _node_t *p;
     void *data = NULL;
 
-    lock_queue(qu);
-    if (unlikely(NULL == qu) || unlikely(NULL == qu->head)) {
-        goto end;
+    if (unlikely(NULL == qu->head)) {
+        return NULL;
     }
     //printf("queue out head length:%d \n",qu->length);
 
@@ -265,8 +465,123 @@ void *dt_queue_pop_head(dt_queue_t * qu)
 
     qu->length--;
     data = p->data;
-    free(p);
-end:
+    node_put(qu, p);
+    return data;
+}
+
+/**
+ * @brief pop data at the head of queue
+ * @param qu    queue
+ * @return  queue node data
+ */
+void *dt_queue_pop_head(dt_queue_t * qu)
+{
+    void *data = NULL;
+    uint32_t length;
+
+    if (unlikely(NULL == qu)) {
+        return NULL;
+    }
+
+    lock_queue(qu);
+    length = qu->length;
+    data = pop_head_locked(qu);
+    // a NULL payload still frees a slot
+    if (qu->length < length) {
+        wakeup_on_queue_space(qu);
+    }
+    unlock_queue(qu);
+    return data;
+}
+
+/**
+ * @brief pop up to n data at the head of queue under one lock
+ * @param qu    queue
+ * @param data  array receiving node data
+ * @param n     max data count
+ * @return  number of data popped
+ */
+int dt_queue_pop_head_n(dt_queue_t * qu, void **data, int n)
+{
+    int count = 0;
+
+    if (unlikely(NULL == qu) || n <= 0) {
+        return 0;
+    }
+
+    lock_queue(qu);
+    while (count < n && qu->head) {
+        data[count++] = pop_head_locked(qu);
+    }
+    if (count > 0) {
+        wakeup_on_queue_space(qu);
+    }
+    unlock_queue(qu);
+    return count;
+}
+
+/**
+ * @brief move all nodes of src to the tail of dst, src left empty
+ *        O(1), max_length of dst is not checked
+ * @param dst   destination queue
+ * @param src   source queue
+ * @return  number of data moved
+ */
+uint32_t dt_queue_splice_tail(dt_queue_t * dst, dt_queue_t * src)
+{
+    dt_queue_t *first, *second;
+    uint32_t moved;
+
+    if (unlikely(NULL == dst) || unlikely(NULL == src) || dst == src) {
+        return 0;
+    }
+
+    // fixed lock order avoids deadlock with a concurrent reverse splice
+    first = dst < src ? dst : src;
+    second = dst < src ? src : dst;
+    lock_queue(first);
+    lock_queue(second);
+
+    moved = src->length;
+    if (src->head) {
+        if (dst->tail) {
+            dst->tail->next = src->head;
+            src->head->prev = dst->tail;
+        } else {
+            dst->head = src->head;
+        }
+        dst->tail = src->tail;
+        dst->length += src->length;
+        src->head = src->tail = NULL;
+        src->length = 0;
+        wakeup_on_queue(dst, moved);
+        wakeup_on_queue_space(src);
+    }
+
+    unlock_queue(second);
+    unlock_queue(first);
+    return moved;
+}
+
+/**
+ * @brief pop data at the head of queue, wait while queue is empty
+ * @param qu      queue
+ * @param timeout millisecond, <= 0 wait forever
+ * @return  queue node data, NULL on timeout
+ */
+void *dt_queue_pop_head_timeout(dt_queue_t * qu, int timeout)
+{
+    void *data = NULL;
+
+    if (unlikely(NULL == qu)) {
+        return NULL;
+    }
+
+    lock_queue(qu);
+    if (wait_data_locked(qu, timeout) == 0) {
+        data = pop_head_locked(qu);
+        wakeup_on_queue_space(qu);
+    }
     unlock_queue(qu);
     return data;
 }
@@ -317,7 +632,8 @@ void *dt_queue_pop_tail(dt_queue_t * qu)
 
     qu->length--;
     data = p->data;
-    free(p);
+    node_put(qu, p);
+    wakeup_on_queue_space(qu);
 
     //printf("queue out tail length:%d \n",qu->length);
 end:
@@ -357,7 +673,8 @@ void *dt_queue_pop_nth(dt_queue_t * qu, uint32_t n)
 
     qu->length--;
     data = p->data;
-    free(p);
+    node_put(qu, p);
+    wakeup_on_queue_space(qu);
 
 end:
     unlock_queue(qu);
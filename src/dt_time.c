@@ -1,5 +1,6 @@
 #include <sys/time.h>
 #include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 #include <stddef.h>
 
@@ -10,6 +11,13 @@ int64_t dt_gettime(void)
     return ((int64_t)(tv.tv_sec) * 1000000 + (int64_t)(tv.tv_usec));
 }
 
+int64_t dt_gettime_relative(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 int dt_usleep(unsigned usec)
 {
     return usleep(usec);
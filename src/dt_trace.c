@@ -0,0 +1,606 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_trace.c
+ *    Description:  binary deferred-format trace log
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+/*
+ * file layout: [header, 4KB][format table][ring]
+ * the ring is split in blocks, a record never crosses a block, the tail of
+ * a block that can not hold the next record is covered by a padding record.
+ * so every block starts with a record and a reader can start at any block.
+ * writers reserve space with a cas on hdr->wr (absolute position, never
+ * wraps), fill the record and publish it by storing the low 32 bits of its
+ * position last. a record whose pos does not match is stale or unfinished.
+ * a writer stalled for a whole lap still copies its record late, on top of
+ * newer published ones; every record carries a hash of its own bytes so
+ * the decoder drops records overwritten that way.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "dt_atomic.h"
+#include "dt_lock.h"
+#include "dt_log.h"
+#include "dt_trace.h"
+
+#define TAG "DT_TRACE"
+
+#define TRACE_MAGIC      "DTTRACE2"
+#define TRACE_HDR_SIZE   4096
+#define TRACE_FMT_SIZE   (64 * 1024)
+#define TRACE_BLOCK_SIZE (64 * 1024)
+#define TRACE_REC_MAX    1024
+
+enum {
+    TRACE_ARG_INT = 1,
+    TRACE_ARG_LONG,
+    TRACE_ARG_LLONG,
+    TRACE_ARG_SIZE,
+    TRACE_ARG_INTMAX,
+    TRACE_ARG_PTRDIFF,
+    TRACE_ARG_DOUBLE,
+    TRACE_ARG_LDOUBLE,
+    TRACE_ARG_PTR,
+    TRACE_ARG_STR,
+};
+
+struct trace_hdr {
+    char magic[8];
+    uint32_t block_size;
+    uint32_t fmt_size;
+    uint64_t ring_size;
+    uint64_t fmt_off;
+    uint64_t ring_off;
+    uint32_t fmt_used;      // bytes of format table in use
+    uint32_t fmt_count;
+    uint64_t wr;            // absolute ring position
+};
+
+/* format table entry, followed by tag\0 file\0 fmt\0, padded to 8 */
+struct trace_fmt {
+    uint32_t id;
+    uint32_t line;
+    uint32_t len;           // entry bytes
+    uint32_t pad;
+};
+
+struct trace_rec {
+    uint32_t pos;           // low 32 bits of ring position, published last
+    uint16_t id;            // 0: padding to block end
+    uint16_t len;           // record bytes, multiple of 8
+    uint32_t sum;           // trace_sum() of the record
+    uint32_t pad;
+    uint64_t ts;            // CLOCK_REALTIME ns
+    // 8 bytes per argument, strings: length slot then bytes padded to 8
+};
+
+int dt_trace_on;
+
+static struct trace_hdr *trace_hdr;
+static uint8_t *trace_ring;
+static size_t trace_map_size;
+static int trace_gen;
+static dt_lock_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline uint32_t trace_align8(uint32_t n)
+{
+    return (n + 7) & ~7U;
+}
+
+/* hash of id, len and every 8 byte word from ts to the record end */
+static uint32_t trace_sum(const struct trace_rec *rec)
+{
+    const uint8_t *p = (const uint8_t *)&rec->ts;
+    const uint8_t *end = (const uint8_t *)rec + rec->len;
+    uint64_t h = ((uint64_t)rec->id << 16 | rec->len) ^ 0x9e3779b97f4a7c15ULL;
+    uint64_t v;
+
+    for (; p < end; p += 8) {
+        memcpy(&v, p, 8);
+        h = (h ^ v) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/* argument kinds of fmt, number of arguments or -1 if unsupported */
+static int trace_parse_fmt(const char *fmt, uint8_t *kind)
+{
+    const char *p = fmt;
+    int n = 0;
+
+    while ((p = strchr(p, '%')) != NULL) {
+        int lmod = 0;           // 'h', 'l', 'L', 'z', 'j', 't', 'q' (ll)
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        p += strspn(p, "-+ #0'");
+        p += strspn(p, "0123456789");
+        if (*p == '.') {
+            p++;
+            p += strspn(p, "0123456789");
+        }
+        if (*p == '*') {
+            return -1;
+        }
+        while (*p && strchr("hlLzjtq", *p)) {
+            lmod = (lmod == 'l' && *p == 'l') ? 'q' : *p;
+            p++;
+        }
+        if (n == DT_TRACE_MAX_ARGS) {
+            return -1;
+        }
+        // %ls / %lc take wide characters, not stored
+        if ((*p == 's' || *p == 'c') && (lmod == 'l' || lmod == 'L' || lmod == 'q')) {
+            return -1;
+        }
+        switch (*p) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            kind[n++] = lmod == 'l' ? TRACE_ARG_LONG : lmod == 'q' || lmod == 'L' ? TRACE_ARG_LLONG :
+                        lmod == 'z' ? TRACE_ARG_SIZE : lmod == 'j' ? TRACE_ARG_INTMAX :
+                        lmod == 't' ? TRACE_ARG_PTRDIFF : TRACE_ARG_INT;
+            break;
+        case 'e': case 'f': case 'g': case 'a': case 'E': case 'F': case 'G': case 'A':
+            kind[n++] = lmod == 'L' ? TRACE_ARG_LDOUBLE : TRACE_ARG_DOUBLE;
+            break;
+        case 'p':
+            kind[n++] = TRACE_ARG_PTR;
+            break;
+        case 's':
+            kind[n++] = TRACE_ARG_STR;
+            break;
+        default:
+            return -1;
+        }
+        p++;
+    }
+    return n;
+}
+
+/* call with trace_lock held */
+static void trace_register(dt_trace_site_t *site)
+{
+    struct trace_hdr *hdr = trace_hdr;
+    struct trace_fmt *entry;
+    size_t tag_len, file_len, fmt_len;
+    uint32_t len;
+    char *s;
+
+    if (site->gen == trace_gen) {
+        return;
+    }
+    site->nargs = trace_parse_fmt(site->fmt, site->kind);
+    tag_len = strlen(site->tag) + 1;
+    file_len = strlen(site->file) + 1;
+    fmt_len = strlen(site->fmt) + 1;
+    len = trace_align8(sizeof(struct trace_fmt) + tag_len + file_len + fmt_len);
+    if (site->nargs < 0 || hdr->fmt_count >= 0xffff || hdr->fmt_used + len > hdr->fmt_size) {
+        dt_error(TAG, "drop trace site %s:%d\n", site->file, site->line);
+        site->id = -1;
+    } else {
+        entry = (struct trace_fmt *)((uint8_t *)hdr + hdr->fmt_off + hdr->fmt_used);
+        entry->id = hdr->fmt_count + 1;
+        entry->line = site->line;
+        entry->len = len;
+        entry->pad = 0;
+        s = (char *)(entry + 1);
+        memcpy(s, site->tag, tag_len);
+        memcpy(s + tag_len, site->file, file_len);
+        memcpy(s + tag_len + file_len, site->fmt, fmt_len);
+        hdr->fmt_used += len;
+        site->id = ++hdr->fmt_count;
+    }
+    dt_atomic_store_release(&site->gen, trace_gen);
+}
+
+/* reserve len bytes inside one block, padding the rest of a full block */
+static uint64_t trace_reserve(struct trace_hdr *hdr, uint32_t len)
+{
+    uint64_t pos = dt_atomic_load(&hdr->wr);
+    for (;;) {
+        uint32_t left = TRACE_BLOCK_SIZE - (uint32_t)(pos % TRACE_BLOCK_SIZE);
+        if (len <= left) {
+            if (dt_atomic_cas_weak(&hdr->wr, &pos, pos + len)) {
+                return pos;
+            }
+            continue;
+        }
+        if (dt_atomic_cas_weak(&hdr->wr, &pos, pos + left)) {
+            struct trace_rec *pad = (struct trace_rec *)(trace_ring + pos % hdr->ring_size);
+            pad->id = 0;
+            pad->len = (uint16_t)left;      // left < block size
+            dt_atomic_store_release(&pad->pos, (uint32_t)pos);
+            pos += left;
+        }
+    }
+}
+
+void dt_trace_write(dt_trace_site_t *site, ...)
+{
+    uint64_t buf[TRACE_REC_MAX / 8];
+    struct trace_rec *rec = (struct trace_rec *)buf;
+    struct trace_hdr *hdr = trace_hdr;
+    uint8_t *p = (uint8_t *)(rec + 1);
+    uint8_t *end = (uint8_t *)buf + TRACE_REC_MAX;
+    struct timespec ts;
+    va_list vl;
+    uint64_t pos;
+    uint32_t len;
+    int i;
+
+    if (!hdr) {
+        return;
+    }
+    if (dt_atomic_load_acquire(&site->gen) != trace_gen) {
+        dt_lock(&trace_lock);
+        trace_register(site);
+        dt_unlock(&trace_lock);
+    }
+    if (site->id < 0) {
+        return;
+    }
+
+    va_start(vl, site);
+    for (i = 0; i < site->nargs; i++) {
+        uint64_t v = 0;
+        switch (site->kind[i]) {
+        case TRACE_ARG_INT:
+            v = (uint64_t)(int64_t)va_arg(vl, int);
+            break;
+        case TRACE_ARG_LONG:
+            v = (uint64_t)(int64_t)va_arg(vl, long);
+            break;
+        case TRACE_ARG_LLONG:
+            v = (uint64_t)va_arg(vl, long long);
+            break;
+        case TRACE_ARG_SIZE:
+            v = (uint64_t)va_arg(vl, size_t);
+            break;
+        case TRACE_ARG_INTMAX:
+            v = (uint64_t)va_arg(vl, intmax_t);
+            break;
+        case TRACE_ARG_PTRDIFF:
+            v = (uint64_t)(int64_t)va_arg(vl, ptrdiff_t);
+            break;
+        case TRACE_ARG_DOUBLE: {
+            double d = va_arg(vl, double);
+            memcpy(&v, &d, sizeof(d));
+            break;
+        }
+        case TRACE_ARG_LDOUBLE: {
+            double d = (double)va_arg(vl, long double);
+            memcpy(&v, &d, sizeof(d));
+            break;
+        }
+        case TRACE_ARG_PTR:
+            v = (uint64_t)(uintptr_t)va_arg(vl, void *);
+            break;
+        case TRACE_ARG_STR: {
+            // keep a slot for this length and every later argument
+            const char *s = va_arg(vl, const char *);
+            size_t room = ((size_t)(end - p) - 8 * (site->nargs - i)) & ~(size_t)7;
+            size_t n = s ? strnlen(s, DT_TRACE_STR_MAX) : 0;
+            if (n > room) {
+                n = room;
+            }
+            v = n;
+            memcpy(p, &v, 8);
+            p += 8;
+            if (n) {
+                memcpy(p, s, n);
+            }
+            p += trace_align8(n);
+            continue;
+        }
+        }
+        memcpy(p, &v, 8);
+        p += 8;
+    }
+    va_end(vl);
+
+    len = (uint32_t)(p - (uint8_t *)buf);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    rec->id = (uint16_t)site->id;
+    rec->len = (uint16_t)len;
+    rec->ts = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    rec->pad = 0;
+    rec->sum = trace_sum(rec);
+
+    pos = trace_reserve(hdr, len);
+    p = trace_ring + pos % hdr->ring_size;
+    memcpy(p + sizeof(uint32_t), (uint8_t *)buf + sizeof(uint32_t), len - sizeof(uint32_t));
+    dt_atomic_store_release(&((struct trace_rec *)p)->pos, (uint32_t)pos);
+}
+
+int dt_trace_open(const char *path, size_t size)
+{
+    struct trace_hdr *hdr;
+    size_t ring_size = (size + TRACE_BLOCK_SIZE - 1) / TRACE_BLOCK_SIZE * TRACE_BLOCK_SIZE;
+    size_t map_size;
+    int fd;
+
+    if (ring_size < 2 * TRACE_BLOCK_SIZE) {
+        ring_size = 2 * TRACE_BLOCK_SIZE;
+    }
+    map_size = TRACE_HDR_SIZE + TRACE_FMT_SIZE + ring_size;
+
+    dt_lock(&trace_lock);
+    if (trace_hdr) {
+        dt_unlock(&trace_lock);
+        dt_error(TAG, "trace file already open\n");
+        return -1;
+    }
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        dt_unlock(&trace_lock);
+        dt_error(TAG, "open %s failed, %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, map_size) < 0) {
+        close(fd);
+        dt_unlock(&trace_lock);
+        dt_error(TAG, "resize %s failed, %s\n", path, strerror(errno));
+        return -1;
+    }
+    hdr = (struct trace_hdr *)mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED) {
+        dt_unlock(&trace_lock);
+        dt_error(TAG, "mmap %s failed, %s\n", path, strerror(errno));
+        return -1;
+    }
+    memcpy(hdr->magic, TRACE_MAGIC, sizeof(hdr->magic));
+    hdr->block_size = TRACE_BLOCK_SIZE;
+    hdr->fmt_size = TRACE_FMT_SIZE;
+    hdr->ring_size = ring_size;
+    hdr->fmt_off = TRACE_HDR_SIZE;
+    hdr->ring_off = TRACE_HDR_SIZE + TRACE_FMT_SIZE;
+    hdr->fmt_used = 0;
+    hdr->fmt_count = 0;
+    hdr->wr = 0;
+
+    trace_hdr = hdr;
+    trace_ring = (uint8_t *)hdr + hdr->ring_off;
+    trace_map_size = map_size;
+    trace_gen++;
+    dt_unlock(&trace_lock);
+    dt_atomic_store_release(&dt_trace_on, 1);
+    dt_info(TAG, "trace %s, ring %zu bytes\n", path, ring_size);
+    return 0;
+}
+
+void dt_trace_close(void)
+{
+    dt_atomic_store_seq(&dt_trace_on, 0);
+    dt_lock(&trace_lock);
+    if (trace_hdr) {
+        msync(trace_hdr, trace_map_size, MS_ASYNC);
+        munmap(trace_hdr, trace_map_size);
+        trace_hdr = NULL;
+        trace_ring = NULL;
+    }
+    dt_unlock(&trace_lock);
+}
+
+/*
+ * decoder
+ */
+
+/* render one conversion spec [spec, spec_end) with the value in slot */
+static int trace_render_arg(FILE *out, const char *spec, size_t spec_len, int kind, const uint8_t *slot)
+{
+    char f[64];
+    uint64_t v;
+    double d;
+
+    if (spec_len >= sizeof(f)) {
+        return -1;
+    }
+    memcpy(f, spec, spec_len);
+    f[spec_len] = 0;
+    memcpy(&v, slot, 8);
+    memcpy(&d, slot, 8);
+
+    switch (kind) {
+    case TRACE_ARG_INT:
+        return fprintf(out, f, (int)v);
+    case TRACE_ARG_LONG:
+        return fprintf(out, f, (long)v);
+    case TRACE_ARG_LLONG:
+        return fprintf(out, f, (long long)v);
+    case TRACE_ARG_SIZE:
+        return fprintf(out, f, (size_t)v);
+    case TRACE_ARG_INTMAX:
+        return fprintf(out, f, (intmax_t)v);
+    case TRACE_ARG_PTRDIFF:
+        return fprintf(out, f, (ptrdiff_t)v);
+    case TRACE_ARG_DOUBLE:
+        return fprintf(out, f, d);
+    case TRACE_ARG_LDOUBLE:
+        return fprintf(out, f, (long double)d);
+    case TRACE_ARG_PTR:
+        return fprintf(out, f, (void *)(uintptr_t)v);
+    case TRACE_ARG_STR: {
+        // slot holds the length, bytes follow, not terminated
+        char s[DT_TRACE_STR_MAX + 1];
+        size_t n = v > DT_TRACE_STR_MAX ? DT_TRACE_STR_MAX : (size_t)v;
+        memcpy(s, slot + 8, n);
+        s[n] = 0;
+        return fprintf(out, f, s);
+    }
+    }
+    return -1;
+}
+
+static void trace_render(FILE *out, const struct trace_rec *rec, const char *tag, const char *fmt,
+                         const uint8_t *kind, int nargs)
+{
+    const uint8_t *slot = (const uint8_t *)(rec + 1);
+    const uint8_t *end = (const uint8_t *)rec + rec->len;
+    const char *p = fmt;
+    time_t sec = (time_t)(rec->ts / 1000000000ULL);
+    struct tm tm_info;
+    char date[32];
+    int i = 0;
+
+    localtime_r(&sec, &tm_info);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm_info);
+    fprintf(out, "[%s.%06u][%s] ", date, (unsigned)(rec->ts % 1000000000ULL / 1000), tag);
+
+    while (*p) {
+        const char *spec = strchr(p, '%');
+        size_t spec_len;
+        if (!spec) {
+            fputs(p, out);
+            break;
+        }
+        fwrite(p, 1, spec - p, out);
+        if (spec[1] == '%') {
+            fputc('%', out);
+            p = spec + 2;
+            continue;
+        }
+        spec_len = strcspn(spec + 1, "diouxXceEfFgGaAps") + 2;
+        if (i >= nargs || end - slot < 8) {
+            break;
+        }
+        if (kind[i] == TRACE_ARG_STR) {
+            uint64_t n;
+            memcpy(&n, slot, 8);
+            // string bytes must lie inside the record
+            if (n > DT_TRACE_STR_MAX || n > (uint64_t)(end - slot - 8)) {
+                break;
+            }
+            trace_render_arg(out, spec, spec_len, kind[i], slot);
+            slot += 8 + trace_align8((uint32_t)n);
+        } else {
+            trace_render_arg(out, spec, spec_len, kind[i], slot);
+            slot += 8;
+        }
+        i++;
+        p = spec + spec_len;
+    }
+}
+
+/* string following s in a format entry, NULL if s is not terminated before end */
+static const char *trace_next_str(const char *s, const char *end)
+{
+    size_t n = strnlen(s, end - s);
+    return n < (size_t)(end - s) ? s + n + 1 : NULL;
+}
+
+int dt_trace_decode(const char *path, FILE *out)
+{
+    struct trace_hdr *hdr;
+    const char **tags = NULL;
+    const char **fmts = NULL;
+    uint8_t (*kinds)[DT_TRACE_MAX_ARGS] = NULL;
+    int *nargs = NULL;
+    const uint8_t *ring;
+    off_t size;
+    uint64_t wr, start, blk;
+    uint32_t off, i;
+    int fd, count = 0;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    size = lseek(fd, 0, SEEK_END);
+    if (size < TRACE_HDR_SIZE) {
+        close(fd);
+        return -1;
+    }
+    hdr = (struct trace_hdr *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED) {
+        return -1;
+    }
+    if (memcmp(hdr->magic, TRACE_MAGIC, sizeof(hdr->magic)) || hdr->block_size != TRACE_BLOCK_SIZE
+        || !hdr->ring_size || hdr->ring_size % TRACE_BLOCK_SIZE
+        || hdr->ring_off + hdr->ring_size > (uint64_t)size || hdr->fmt_used > hdr->fmt_size
+        || hdr->fmt_off + hdr->fmt_size > (uint64_t)size
+        || hdr->fmt_count > hdr->fmt_used / sizeof(struct trace_fmt)) {
+        munmap(hdr, size);
+        return -1;
+    }
+
+    // format table, index = id
+    tags = (const char **)calloc(hdr->fmt_count + 1, sizeof(*tags));
+    fmts = (const char **)calloc(hdr->fmt_count + 1, sizeof(*fmts));
+    kinds = calloc(hdr->fmt_count + 1, sizeof(*kinds));
+    nargs = (int *)calloc(hdr->fmt_count + 1, sizeof(*nargs));
+    if (!tags || !fmts || !kinds || !nargs) {
+        count = -1;
+        goto end;
+    }
+    for (off = 0; off + sizeof(struct trace_fmt) <= hdr->fmt_used;) {
+        struct trace_fmt *entry = (struct trace_fmt *)((uint8_t *)hdr + hdr->fmt_off + off);
+        if (entry->len < sizeof(struct trace_fmt) || entry->len > hdr->fmt_used - off) {
+            break;
+        }
+        if (entry->id && entry->id <= hdr->fmt_count) {
+            const char *tag = (const char *)(entry + 1);
+            const char *entry_end = (const char *)entry + entry->len;
+            const char *file = trace_next_str(tag, entry_end);
+            const char *fmt = file ? trace_next_str(file, entry_end) : NULL;
+
+            if (fmt && trace_next_str(fmt, entry_end)) {
+                tags[entry->id] = tag;
+                fmts[entry->id] = fmt;
+                nargs[entry->id] = trace_parse_fmt(fmt, kinds[entry->id]);
+            }
+        }
+        off += entry->len;
+    }
+
+    // oldest whole block still in the ring up to wr
+    ring = (const uint8_t *)hdr + hdr->ring_off;
+    wr = hdr->wr;
+    start = wr > hdr->ring_size ? wr - hdr->ring_size : 0;
+    start = (start + TRACE_BLOCK_SIZE - 1) / TRACE_BLOCK_SIZE * TRACE_BLOCK_SIZE;
+    for (blk = start; blk < wr; blk += TRACE_BLOCK_SIZE) {
+        uint64_t pos = blk;
+        while (pos + sizeof(struct trace_rec) <= blk + TRACE_BLOCK_SIZE && pos < wr) {
+            const struct trace_rec *rec = (const struct trace_rec *)(ring + pos % hdr->ring_size);
+            if (rec->pos != (uint32_t)pos || !rec->id || rec->len < sizeof(struct trace_rec)
+                || pos % TRACE_BLOCK_SIZE + rec->len > TRACE_BLOCK_SIZE || rec->sum != trace_sum(rec)) {
+                break;          // padding, unfinished, overwritten or corrupt
+            }
+            i = rec->id;
+            if (i <= hdr->fmt_count && fmts[i] && nargs[i] >= 0) {
+                trace_render(out, rec, tags[i], fmts[i], kinds[i], nargs[i]);
+                count++;
+            }
+            pos += rec->len;
+        }
+    }
+end:
+    free(tags);
+    free(fmts);
+    free(kinds);
+    free(nargs);
+    munmap(hdr, size);
+    return count;
+}
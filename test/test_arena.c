@@ -0,0 +1,124 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_arena.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dt_arena.h"
+#include "dt_array.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-ARENA"
+
+#define FRAMES      10000
+#define FRAME_ALLOCS 64
+
+static int test_basic(void)
+{
+    dt_arena_t *arena = dt_arena_create(1024);
+    dt_arena_mark_t mark;
+    int *tab = NULL;
+    int i, nb = 0, ret = 0;
+    char *s;
+    void *big;
+
+    s = dt_arena_strdup(arena, "dtutils");
+    if (!s || strcmp(s, "dtutils") || ((uintptr_t)s & (DT_ARENA_ALIGN - 1))) {
+        ret = -1;
+    }
+    s = dt_arena_strndup(arena, "dtutils", 2);
+    if (!s || strcmp(s, "dt")) {
+        ret = -1;
+    }
+
+    // grows in place while it is the last block
+    for (i = 0; i < 1000; i++) {
+        dt_arena_dynarray2_add(arena, (void **)&tab, &nb, sizeof(int), (uint8_t *)&i);
+    }
+    for (i = 0; i < nb; i++) {
+        if (tab[i] != i) {
+            ret = -1;
+        }
+    }
+
+    mark = dt_arena_mark(arena);
+    big = dt_arena_alloc_align(arena, 64 * 1024, 64);
+    if (!big || ((uintptr_t)big & 63)) {
+        ret = -1;
+    }
+    dt_arena_rollback(arena, mark);
+    if (dt_arena_alloc(arena, 16) == NULL) {
+        ret = -1;
+    }
+
+    size_t size = dt_arena_size(arena);
+    dt_arena_reset(arena);
+    if (dt_arena_used(arena) != 0) {
+        ret = -1;
+    }
+    // same workload after reset reuses kept chunks
+    for (i = 0, nb = 0, tab = NULL; i < 1000; i++) {
+        dt_arena_dynarray2_add(arena, (void **)&tab, &nb, sizeof(int), (uint8_t *)&i);
+    }
+    dt_arena_alloc_align(arena, 64 * 1024, 64);
+    if (dt_arena_size(arena) != size) {
+        dt_error(TAG, "arena grew after reset: %zu -> %zu\n", size, dt_arena_size(arena));
+        ret = -1;
+    }
+    dt_arena_destroy(arena);
+    dt_info(TAG, "basic test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+/* per-frame scratch: many small strings/blobs dropped together */
+static void bench(int use_arena)
+{
+    dt_arena_t *arena = dt_arena_create(64 * 1024);
+    void *ptr[FRAME_ALLOCS];
+    char name[FRAME_ALLOCS][32];
+    int64_t start, cost;
+    int f, i;
+
+    for (i = 0; i < FRAME_ALLOCS; i++) {
+        snprintf(name[i], sizeof(name[i]), "frame-side-data-%d", i);
+    }
+    start = dt_gettime();
+    for (f = 0; f < FRAMES; f++) {
+        for (i = 0; i < FRAME_ALLOCS; i++) {
+            ptr[i] = use_arena ? (void *)dt_arena_strdup(arena, name[i]) : (void *)dt_strdup(name[i]);
+        }
+        if (use_arena) {
+            dt_arena_reset(arena);
+            continue;
+        }
+        for (i = 0; i < FRAME_ALLOCS; i++) {
+            dt_free(ptr[i]);
+        }
+    }
+    cost = dt_gettime() - start;
+    dt_info(TAG, "%-6s: %d frames x %d strdup, %.1f ns/alloc\n", use_arena ? "arena" : "malloc",
+            FRAMES, FRAME_ALLOCS, (double)cost * 1000 / (FRAMES * FRAME_ALLOCS));
+    dt_arena_destroy(arena);
+}
+
+int main(int argc, char **argv)
+{
+    int ret = test_basic();
+    bench(0);
+    bench(1);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_buffer.c
+ *    Description:  dt_buffer_t throughput, locked vs spsc vs zero-copy/mirror
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "dt_buffer.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-BUFFER"
+
+#define BUF_SIZE   (1024 * 1024)
+#define CHUNK_SIZE 4096
+#define TOTAL_SIZE ((int64_t)1024 * 1024 * 1024)
+
+struct bench_ctx {
+    dt_buffer_t dbt;
+    int zerocopy;
+    int error;
+};
+
+static void *producer_zerocopy(struct bench_ctx *ctx)
+{
+    dtbuf_span_t span;
+    int64_t sent = 0;
+    int i, j;
+
+    while (sent < TOTAL_SIZE) {
+        int len = dtbuf_reserve(&ctx->dbt, &span, CHUNK_SIZE);
+        if (len == 0) {
+            sched_yield();
+            continue;
+        }
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < span.len[i]; j++) {
+                span.ptr[i][j] = (uint8_t)(sent + j);
+            }
+            sent += span.len[i];
+        }
+        dtbuf_commit(&ctx->dbt, len);
+    }
+    return NULL;
+}
+
+static void *consumer_zerocopy(struct bench_ctx *ctx)
+{
+    dtbuf_span_t span;
+    int64_t recv = 0;
+    int i;
+
+    while (recv < TOTAL_SIZE) {
+        int len = dtbuf_peek(&ctx->dbt, &span, CHUNK_SIZE);
+        if (len == 0) {
+            sched_yield();
+            continue;
+        }
+        for (i = 0; i < 2; i++) {
+            int n = span.len[i];
+            if (n && (span.ptr[i][0] != (uint8_t)recv || span.ptr[i][n - 1] != (uint8_t)(recv + n - 1))) {
+                ctx->error = 1;
+            }
+            recv += n;
+        }
+        dtbuf_consume(&ctx->dbt, len);
+    }
+    return NULL;
+}
+
+static void *producer(void *arg)
+{
+    struct bench_ctx *ctx = (struct bench_ctx *)arg;
+    if (ctx->zerocopy) {
+        return producer_zerocopy(ctx);
+    }
+    uint8_t chunk[CHUNK_SIZE];
+    int64_t sent = 0;
+    int i;
+
+    while (sent < TOTAL_SIZE) {
+        for (i = 0; i < CHUNK_SIZE; i++) {
+            chunk[i] = (uint8_t)(sent + i);
+        }
+        int off = 0;
+        while (off < CHUNK_SIZE) {
+            int ret = dtbuf_put(&ctx->dbt, chunk + off, CHUNK_SIZE - off);
+            if (ret == 0) {
+                sched_yield();
+                continue;
+            }
+            off += ret;
+        }
+        sent += CHUNK_SIZE;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    struct bench_ctx *ctx = (struct bench_ctx *)arg;
+    if (ctx->zerocopy) {
+        return consumer_zerocopy(ctx);
+    }
+    uint8_t chunk[CHUNK_SIZE];
+    int64_t recv = 0;
+
+    while (recv < TOTAL_SIZE) {
+        int ret = dtbuf_get(&ctx->dbt, chunk, CHUNK_SIZE);
+        if (ret == 0) {
+            sched_yield();
+            continue;
+        }
+        // check first & last byte, full check would dominate the bench
+        if (chunk[0] != (uint8_t)recv || chunk[ret - 1] != (uint8_t)(recv + ret - 1)) {
+            ctx->error = 1;
+        }
+        recv += ret;
+    }
+    return NULL;
+}
+
+/*
+ * single thread reserve/commit/peek/consume, chunks not dividing the size
+ * so spans regularly split at the end of the buffer
+ */
+static int test_span(const char *name, int flags)
+{
+    dt_buffer_t dbt;
+    dtbuf_span_t span;
+    uint8_t wv = 0, rv = 0;
+    int i, j, k, len, want, wrapped = 0, ret = 0;
+
+    if (dtbuf_init2(&dbt, 4096, flags) < 0) {
+        return -1;
+    }
+    for (i = 0; i < 100 && !ret; i++) {
+        want = 1000 + i * 37 % 900;
+        len = dtbuf_reserve(&dbt, &span, want);
+        if (len != want) {
+            ret = -1;
+            break;
+        }
+        for (k = 0; k < 2; k++) {
+            for (j = 0; j < span.len[k]; j++) {
+                span.ptr[k][j] = wv++;
+            }
+        }
+        wrapped += span.len[1] > 0;
+        // more than is free must be refused
+        if (dtbuf_commit(&dbt, len) < 0 || dtbuf_commit(&dbt, 4096) == 0) {
+            ret = -1;
+        }
+        len = dtbuf_peek(&dbt, &span, 4096);
+        if (len != want) {
+            ret = -1;
+        }
+        for (k = 0; k < 2; k++) {
+            for (j = 0; j < span.len[k]; j++) {
+                if (span.ptr[k][j] != rv++) {
+                    ret = -1;
+                }
+            }
+        }
+        if (dtbuf_consume(&dbt, len + 1) == 0 || dtbuf_consume(&dbt, len) < 0) {
+            ret = -1;
+        }
+    }
+    if (!wrapped) {
+        ret = -1;
+    }
+    dtbuf_release(&dbt);
+    dt_info(TAG, "%-6s: span test, %d wraps %s\n", name, wrapped, ret ? "failed" : "ok");
+    return ret;
+}
+
+static int run_bench(const char *name, int flags, int zerocopy)
+{
+    struct bench_ctx ctx;
+    pthread_t tp, tc;
+    int64_t start, cost;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.zerocopy = zerocopy;
+    if (dtbuf_init2(&ctx.dbt, BUF_SIZE, flags) < 0) {
+        dt_error(TAG, "buffer init failed\n");
+        return -1;
+    }
+
+    start = dt_gettime();
+    pthread_create(&tc, NULL, consumer, &ctx);
+    pthread_create(&tp, NULL, producer, &ctx);
+    pthread_join(tp, NULL);
+    pthread_join(tc, NULL);
+    cost = dt_gettime() - start;
+
+    dt_info(TAG, "%-6s: %lld MB in %lld us, %.1f MB/s %s\n", name,
+            (long long)(TOTAL_SIZE >> 20), (long long)cost,
+            (double)TOTAL_SIZE / cost * 1000000 / (1 << 20),
+            ctx.error ? "DATA MISMATCH" : "");
+    dtbuf_release(&ctx.dbt);
+    return ctx.error ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= test_span("locked", 0);
+    ret |= test_span("spsc", DTBUF_FLAG_SPSC);
+    ret |= run_bench("locked", 0, 0);
+    ret |= run_bench("zlock", 0, 1);
+    ret |= run_bench("spsc", DTBUF_FLAG_SPSC, 0);
+    ret |= run_bench("zcopy", DTBUF_FLAG_SPSC, 1);
+    ret |= run_bench("mirror", DTBUF_FLAG_SPSC | DTBUF_FLAG_MIRROR, 1);
+    return ret ? 1 : 0;
+}
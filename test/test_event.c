@@ -14,7 +14,10 @@
  * =====================================================================================
  */
 
+#include <stdlib.h>
+
 #include "dt_event.h"
+#include "dt_time.h"
 #include "dt_log.h"
 
 #define TAG "TEST-EVENT"
@@ -22,7 +25,8 @@
 #define EVENT_SERVER_ID_TEST   0x100
 #define EVENT_SERVER_NAME_TEST "SERVER-TEST"
 
-#define EVNET_TEST 0x100
+#define EVNET_TEST   0x100
+#define EVNET_STATUS 0x101
 
 int main(int argc, char **argv)
 {
@@ -35,8 +39,63 @@ int main(int argc, char **argv)
     event_t *event_tmp = dt_get_event(server);
     if (event_tmp) {
         dt_info(TAG, "Get event:%d \n", event_tmp->type);
+        dt_release_event(event_tmp);
+    }
+
+    // async send, receiver blocks until transport loop routes it
+    int64_t start = dt_gettime();
+    dt_send_event(mgt, dt_alloc_event(EVENT_SERVER_ID_TEST, EVNET_TEST));
+    event_tmp = dt_get_event_timeout(server, 1000);
+    if (event_tmp) {
+        dt_info(TAG, "Get async event:%d cost:%lld us\n", event_tmp->type, (long long)(dt_gettime() - start));
+        dt_release_event(event_tmp);
+    }
+
+    // async batch, chain order kept at receiver
+    int i, ret = 0;
+    event_t *chain = NULL;
+    for (i = 3; i >= 0; i--) {
+        event_t *e = dt_alloc_event(EVENT_SERVER_ID_TEST, EVNET_TEST);
+        e->arg = i;
+        e->next = chain;
+        chain = e;
+    }
+    dt_send_event_batch(mgt, chain);
+    for (i = 0; i < 4; i++) {
+        event_tmp = dt_get_event_timeout(server, 1000);
+        if (!event_tmp || event_tmp->arg != (unsigned long)i) {
+            dt_error(TAG, "batch event %d lost or out of order\n", i);
+            ret = -1;
+        }
+        dt_release_event(event_tmp);
     }
+
+    // priority lanes: urgent first, coalesced status keeps last arg
+    dt_server_set_coalesce(server, 1);
+    for (i = 0; i < 3; i++) {
+        event_tmp = dt_alloc_event(EVENT_SERVER_ID_TEST, EVNET_STATUS);
+        event_tmp->priority = EVENT_PRIORITY_LOW;
+        event_tmp->arg = i;
+        dt_send_event_sync(mgt, event_tmp);
+    }
+    event_tmp = dt_alloc_event(EVENT_SERVER_ID_TEST, EVNET_TEST);
+    event_tmp->priority = EVENT_PRIORITY_URGENT;
+    dt_send_event_sync(mgt, event_tmp);
+
+    event_tmp = dt_get_event(server);
+    if (!event_tmp || event_tmp->type != EVNET_TEST) {
+        dt_error(TAG, "urgent event not delivered first\n");
+        ret = -1;
+    }
+    dt_release_event(event_tmp);
+    event_tmp = dt_get_event(server);
+    if (!event_tmp || event_tmp->type != EVNET_STATUS || event_tmp->arg != 2 || dt_get_event(server)) {
+        dt_error(TAG, "status events not coalesced\n");
+        ret = -1;
+    }
+    dt_release_event(event_tmp);
+
     dt_remove_server(mgt, server);
     dt_event_server_release(mgt);
-    return 0;
+    return ret ? 1 : 0;
 }
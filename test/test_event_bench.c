@@ -0,0 +1,193 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_event_bench.c
+ *    Description:  event enqueue/dequeue cost with a large backlog
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "dt_event.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-EVENT-BENCH"
+
+#define EVENT_SERVER_ID_BENCH   0x100
+#define EVENT_SERVER_NAME_BENCH "SERVER-BENCH"
+
+#define EVENT_SERVER_ID_ECHO    0x101
+#define EVENT_SERVER_NAME_ECHO  "SERVER-ECHO"
+
+#define EVENT_BENCH 0x100
+#define EVENT_QUIT  0x101
+#define BACKLOG     100000
+#define PINGPONG    20000
+
+#define BATCH_SIZE  32
+
+static void send_backlog(dt_server_mgt_t *mgt, int batch)
+{
+    event_t *head = NULL, *tail = NULL;
+    int i, n = 0;
+
+    for (i = 0; i < BACKLOG; i++) {
+        event_t *event = dt_alloc_event(EVENT_SERVER_ID_BENCH, EVENT_BENCH);
+        event->arg = i;
+        if (!batch) {
+            dt_send_event_sync(mgt, event);
+            continue;
+        }
+        if (tail) {
+            tail->next = event;
+        } else {
+            head = event;
+        }
+        tail = event;
+        if (++n == BATCH_SIZE || i == BACKLOG - 1) {
+            dt_send_event_batch_sync(mgt, head);
+            head = tail = NULL;
+            n = 0;
+        }
+    }
+}
+
+static int bench_backlog(dt_server_mgt_t *mgt, event_server_t *server, int batch)
+{
+    int64_t start, cost_send, cost_get;
+    int got = 0;
+
+    // keep per-event INFO logs out of the measurement
+    dt_set_log_level(DT_LOG_ERROR);
+    start = dt_gettime();
+    send_backlog(mgt, batch);
+    cost_send = dt_gettime() - start;
+
+    start = dt_gettime();
+    event_t *event;
+    while ((event = dt_get_event(server)) != NULL) {
+        if (event->arg != (unsigned long)got) {
+            dt_set_log_level(DT_LOG_INFO);
+            dt_error(TAG, "event out of order: %lu != %d\n", event->arg, got);
+            dt_release_event(event);
+            return -1;
+        }
+        got++;
+        dt_release_event(event);
+    }
+    cost_get = dt_gettime() - start;
+    dt_set_log_level(DT_LOG_INFO);
+
+    dt_info(TAG, "backlog %d %s: send %lld us (%.1f ns/event), get %lld us\n", BACKLOG,
+            batch ? "batch" : "single", (long long)cost_send,
+            (double)cost_send * 1000 / BACKLOG, (long long)cost_get);
+    return got == BACKLOG ? 0 : -1;
+}
+
+struct echo_ctx {
+    dt_server_mgt_t *mgt;
+    event_server_t *server;
+    int sync;
+};
+
+/* bounce every event back to the bench server */
+static void *echo_loop(void *arg)
+{
+    struct echo_ctx *ctx = (struct echo_ctx *)arg;
+    for (;;) {
+        event_t *event = dt_get_event_timeout(ctx->server, 0);
+        if (!event) {
+            continue;
+        }
+        if (event->type == EVENT_QUIT) {
+            dt_release_event(event);
+            break;
+        }
+        event->server_id = EVENT_SERVER_ID_BENCH;
+        if (ctx->sync) {
+            dt_send_event_sync(ctx->mgt, event);
+        } else {
+            dt_send_event(ctx->mgt, event);
+        }
+    }
+    return NULL;
+}
+
+/* one event in flight, report average one-way latency */
+static int bench_latency(const char *name, int flags, int sync)
+{
+    dt_server_mgt_t *mgt = dt_event_server_create2(flags);
+    event_server_t *server = dt_alloc_server(EVENT_SERVER_ID_BENCH, EVENT_SERVER_NAME_BENCH);
+    struct echo_ctx ctx;
+    pthread_t tid;
+    int64_t start, cost;
+    int i, ret = 0;
+
+    dt_register_server(mgt, server);
+    ctx.mgt = mgt;
+    ctx.server = dt_alloc_server(EVENT_SERVER_ID_ECHO, EVENT_SERVER_NAME_ECHO);
+    ctx.sync = sync;
+    dt_register_server(mgt, ctx.server);
+    pthread_create(&tid, NULL, echo_loop, &ctx);
+
+    dt_set_log_level(DT_LOG_ERROR);
+    start = dt_gettime();
+    for (i = 0; i < PINGPONG; i++) {
+        event_t *event = dt_alloc_event(EVENT_SERVER_ID_ECHO, EVENT_BENCH);
+        event->arg = i;
+        if (sync) {
+            dt_send_event_sync(mgt, event);
+        } else {
+            dt_send_event(mgt, event);
+        }
+        event = dt_get_event_timeout(server, 1000);
+        if (!event || event->arg != (unsigned long)i) {
+            ret = -1;
+            dt_release_event(event);
+            break;
+        }
+        dt_release_event(event);
+    }
+    cost = dt_gettime() - start;
+    dt_send_event_sync(mgt, dt_alloc_event(EVENT_SERVER_ID_ECHO, EVENT_QUIT));
+    pthread_join(tid, NULL);
+    dt_set_log_level(DT_LOG_INFO);
+
+    dt_info(TAG, "latency %-6s: %.2f us/hop %s\n", name, (double)cost / (PINGPONG * 2),
+            ret ? "LOST EVENT" : "");
+    dt_remove_server(mgt, ctx.server);
+    dt_remove_server(mgt, server);
+    dt_event_server_release(mgt);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+
+    ret |= bench_latency("async", 0, 0);
+    ret |= bench_latency("sync", 0, 1);
+    ret |= bench_latency("direct", DT_EVENT_FLAG_DIRECT, 1);
+
+    dt_server_mgt_t *mgt = dt_event_server_create();
+    event_server_t *server = dt_alloc_server(EVENT_SERVER_ID_BENCH, EVENT_SERVER_NAME_BENCH);
+    dt_register_server(mgt, server);
+
+    ret |= bench_backlog(mgt, server, 0);
+    ret |= bench_backlog(mgt, server, 0);     // warm event pool
+    ret |= bench_backlog(mgt, server, 1);
+
+    dt_remove_server(mgt, server);
+    dt_event_server_release(mgt);
+    return ret ? 1 : 0;
+}
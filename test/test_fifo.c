@@ -0,0 +1,154 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_fifo.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "dt_fifo.h"
+#include "dt_log.h"
+
+#define TAG "TEST-FIFO"
+
+#define FIFO_SIZE  4096
+#define ROUNDS     64
+
+// mirror sizes round up to the page, leave room for 64KB pages
+static uint8_t scratch[1 << 20];
+
+/* bytes are numbered by stream position, any reorder or loss shows up */
+static void fill(uint8_t *buf, int len, uint32_t pos)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        buf[i] = (uint8_t)((pos + i) * 7 + (pos + i) / 251);
+    }
+}
+
+static int check(const uint8_t *buf, int len, uint32_t pos)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        if (buf[i] != (uint8_t)((pos + i) * 7 + (pos + i) / 251)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int write_seq(dt_fifo *f, int len, uint32_t *wpos)
+{
+    fill(scratch, len, *wpos);
+    if (dt_fifo_generic_write(f, scratch, len, NULL) != len) {
+        return -1;
+    }
+    *wpos += len;
+    return 0;
+}
+
+static int read_seq(dt_fifo *f, int len, uint32_t *rpos)
+{
+    if (dt_fifo_generic_read(f, scratch, len, NULL) < 0 || check(scratch, len, *rpos)) {
+        return -1;
+    }
+    *rpos += len;
+    return 0;
+}
+
+/*
+ * stream bytes through the fifo so every round crosses the end of the
+ * buffer, then grow it with data straddling the wrap point
+ */
+static int test_fifo(const char *name, int mirror)
+{
+    dt_fifo *f = mirror ? dt_fifo_alloc_mirror(FIFO_SIZE) : dt_fifo_alloc(FIFO_SIZE);
+    uint32_t wpos = 0, rpos = 0;
+    int cap, i, ret = 0;
+
+    if (!f) {
+        // memfd / mmap not available
+        dt_info(TAG, "%-6s: not supported, skipped\n", name);
+        return mirror ? 0 : -1;
+    }
+    cap = f->end - f->buffer;
+    if (mirror && (!(f->flags & DT_FIFO_FLAG_MIRROR) || cap < FIFO_SIZE)) {
+        ret = -1;
+        goto end;
+    }
+
+    for (i = 0; i < ROUNDS && !ret; i++) {
+        int len = cap / 3 + i * 13 % 97;
+        if (write_seq(f, len, &wpos) < 0 || dt_fifo_size(f) != len) {
+            ret = -1;
+            break;
+        }
+        // whole span readable in place, the mirror hides the wrap
+        if (mirror && check(dt_fifo_peek2(f, 0), len, rpos)) {
+            ret = -1;
+            break;
+        }
+        ret = read_seq(f, len, &rpos);
+    }
+
+    // park the pointers just before the end and write across it
+    if (!ret) {
+        int park = cap - 100 - (int)(f->rptr - f->buffer);
+        if (park < 0) {
+            park += cap;
+        }
+        ret = write_seq(f, park, &wpos) | read_seq(f, park, &rpos);
+    }
+    if (!ret && (write_seq(f, 1000, &wpos) < 0 || f->wptr - f->buffer != 900)) {
+        ret = -1;
+    }
+    if (!ret && mirror) {
+        // both halves alias the same pages
+        if (memcmp(f->buffer, f->buffer + cap, cap) || check(dt_fifo_peek2(f, 0), 1000, rpos)) {
+            ret = -1;
+        }
+    }
+
+    // grow keeps the unread bytes in order and the mirror mapping
+    if (!ret && (dt_fifo_grow(f, cap) < 0 || f->end - f->buffer < 2 * cap
+                 || (mirror && !(f->flags & DT_FIFO_FLAG_MIRROR)) || dt_fifo_size(f) != 1000)) {
+        ret = -1;
+    }
+    if (!ret) {
+        cap = f->end - f->buffer;
+        ret = write_seq(f, cap - 1000, &wpos);
+    }
+    if (!ret && (dt_fifo_space(f) != 0 || (mirror && check(dt_fifo_peek2(f, 0), cap, rpos)))) {
+        ret = -1;
+    }
+    if (!ret) {
+        ret = read_seq(f, cap, &rpos);
+    }
+    if (!ret && (dt_fifo_size(f) != 0 || wpos != rpos)) {
+        ret = -1;
+    }
+
+end:
+    dt_fifo_free(f);
+    dt_info(TAG, "%-6s: %u bytes through, test %s\n", name, wpos, ret ? "failed" : "ok");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= test_fifo("plain", 0);
+    ret |= test_fifo("mirror", 1);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_log.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dt_log.h"
+#include "dt_time.h"
+
+#define TAG "TEST-LOG"
+
+#define THREADS      4
+#define THREAD_LINES 20000
+
+static void *worker(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    int i;
+    for (i = 0; i < THREAD_LINES; i++) {
+        dt_info(TAG, "thread %d line %d\n", id, i);
+    }
+    return NULL;
+}
+
+/* every line whole, per-thread order kept */
+static int check_sink(FILE *fp)
+{
+    char line[1024];
+    int next[THREADS] = { 0 };
+    int id, n, lines = 0, ret = 0;
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = strstr(line, "[" TAG "] thread ");
+        if (!p) {
+            continue;
+        }
+        if (sscanf(p, "[" TAG "] thread %d line %d", &id, &n) != 2 || id < 0 || id >= THREADS
+            || n != next[id] || line[strlen(line) - 1] != '\n') {
+            ret = -1;
+            break;
+        }
+        next[id]++;
+        lines++;
+    }
+    if (lines != THREADS * THREAD_LINES) {
+        ret = -1;
+    }
+    return ret;
+}
+
+static int run(int async)
+{
+    char path[] = "/tmp/test_log_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *fp;
+    pthread_t tid[THREADS];
+    int64_t start, cost;
+    int i, ret;
+
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    dt_log_set_sink(fd);
+    if (async) {
+        dt_log_async_start(0);
+    }
+    start = dt_gettime();
+    for (i = 0; i < THREADS; i++) {
+        pthread_create(&tid[i], NULL, worker, (void *)(intptr_t)i);
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    cost = dt_gettime() - start;
+    if (async) {
+        dt_log_async_stop();
+    }
+    dt_log_set_sink(-1);
+
+    fp = fdopen(fd, "r");
+    ret = check_sink(fp);
+    fclose(fp);
+    dt_info(TAG, "%-5s: %d threads, %.1f ns/line %s\n", async ? "async" : "sync", THREADS,
+            (double)cost * 1000 / (THREADS * THREAD_LINES), ret ? "failed" : "ok");
+    return ret;
+}
+
+static int count_arg(int *n)
+{
+    return ++*n;
+}
+
+/* filtered macro lines must not evaluate their arguments */
+static int test_macro(void)
+{
+    int n = 0, i, ret = 0;
+    int64_t start, cost_func, cost_macro;
+
+    start = dt_gettime();
+    for (i = 0; i < 1000000; i++) {
+        dt_debug(TAG, "filtered %d\n", count_arg(&n));
+    }
+    cost_func = dt_gettime() - start;
+    n = 0;
+    start = dt_gettime();
+    for (i = 0; i < 1000000; i++) {
+        DT_LOGD(TAG, "filtered %d\n", count_arg(&n));
+    }
+    cost_macro = dt_gettime() - start;
+    if (n != 0) {
+        ret = -1;
+    }
+    DT_LOGE(TAG, "not filtered %d\n", count_arg(&n));
+    if (n != 1) {
+        ret = -1;
+    }
+    dt_info(TAG, "filtered debug: call %.2f ns, macro %.2f ns %s\n", (double)cost_func / 1000,
+            (double)cost_macro / 1000, ret ? "failed" : "ok");
+    return ret;
+}
+
+/* a tag longer than a line still gives one cut, newline terminated line */
+static int test_long_tag(void)
+{
+    char path[] = "/tmp/test_log_XXXXXX";
+    char tag[1500];
+    char line[2048];
+    int fd = mkstemp(path);
+    FILE *fp;
+    int ret = 0;
+
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    memset(tag, 't', sizeof(tag) - 1);
+    tag[sizeof(tag) - 1] = 0;
+    dt_log_set_sink(fd);
+    dt_info(tag, "message %d\n", 1);
+    dt_log_set_sink(-1);
+
+    fp = fdopen(fd, "r");
+    rewind(fp);
+    if (!fgets(line, sizeof(line), fp) || strlen(line) >= 1024 || line[strlen(line) - 1] != '\n'
+        || fgets(line, sizeof(line), fp)) {
+        ret = -1;
+    }
+    fclose(fp);
+    dt_info(TAG, "long tag test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= test_macro();
+    ret |= test_long_tag();
+    ret |= run(0);
+    ret |= run(1);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_log_bench.c
+ *    Description:  dt_log throughput, timestamp cache on/off
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "dt_log.h"
+#include "dt_time.h"
+
+#define TAG "TEST-LOG-BENCH"
+
+#define LINES 200000
+
+struct bench_ctx {
+    int lines;
+};
+
+static void *worker(void *arg)
+{
+    struct bench_ctx *ctx = (struct bench_ctx *)arg;
+    int i;
+    for (i = 0; i < ctx->lines; i++) {
+        dt_info(TAG, "event %d from server %s, count:%d\n", i, "bench", i & 63);
+    }
+    return NULL;
+}
+
+static double bench(int sink, int time_mode, int async, int threads)
+{
+    struct bench_ctx ctx = { LINES / threads };
+    pthread_t tid[8];
+    int64_t start, cost;
+    int i;
+
+    dt_log_set_time(time_mode);
+    dt_log_set_sink(sink);
+    if (async) {
+        dt_log_async_start(0);
+    }
+    start = dt_gettime_relative();
+    for (i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, worker, &ctx);
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    if (async) {
+        dt_log_async_stop();
+    }
+    cost = dt_gettime_relative() - start;
+    dt_log_set_sink(-1);
+    dt_log_set_time(DT_LOG_TIME_WALL);
+    return (double)ctx.lines * threads * 1000000 / (cost ? cost : 1);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        int mode;
+    } modes[] = {
+        { "no cache", DT_LOG_TIME_WALL_NOCACHE },
+        { "cached",   DT_LOG_TIME_WALL },
+        { "mono",     DT_LOG_TIME_MONO },
+    };
+    int sink = open("/dev/null", O_WRONLY);
+    int i;
+
+    if (sink < 0) {
+        return 1;
+    }
+    for (i = 0; i < 3; i++) {
+        double sync1 = bench(sink, modes[i].mode, 0, 1);
+        double sync4 = bench(sink, modes[i].mode, 0, 4);
+        double async4 = bench(sink, modes[i].mode, 1, 4);
+        dt_info(TAG, "%-8s: sync 1 thread %.0f lines/s, sync 4 threads %.0f lines/s, async 4 threads %.0f lines/s\n",
+                modes[i].name, sync1, sync4, async4);
+    }
+    close(sink);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_mem.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dt_mem.h"
+#include "dt_log.h"
+
+#define TAG "TEST-MEM"
+
+#ifndef DT_MEM_ALIGN
+#define DT_MEM_ALIGN 16
+#endif
+
+#define MISALIGNED(p) ((uintptr_t)(p) & (DT_MEM_ALIGN - 1))
+
+static int test_align(void)
+{
+    uint8_t *p, *q;
+    size_t size;
+    int i, ret = 0;
+
+    for (size = 1; size <= (1 << 20); size = size * 3 + 1) {
+        p = (uint8_t *)dt_malloc(size);
+        q = (uint8_t *)dt_mallocz(size);
+        if (!p || !q || MISALIGNED(p) || MISALIGNED(q) || q[size - 1]) {
+            ret = -1;
+        }
+        dt_free(p);
+        dt_free(q);
+    }
+
+    // grow and shrink, content and alignment must survive every step
+    p = NULL;
+    for (i = 1; i <= 64; i++) {
+        size = (size_t)(i * 37) % 4099 + 1;
+        q = (uint8_t *)dt_realloc(p, size);
+        if (!q || MISALIGNED(q)) {
+            ret = -1;
+            break;
+        }
+        if (p && q[0] != (uint8_t)(i - 1)) {
+            ret = -1;
+        }
+        p = q;
+        memset(p, i, size);
+    }
+    dt_free(p);
+    dt_info(TAG, "align %d test %s\n", DT_MEM_ALIGN, ret ? "failed" : "ok");
+    return ret;
+}
+
+/* runs before any other allocation, tracking can only start then */
+static int test_track(void)
+{
+    uint8_t *a, *b;
+    dt_mem_stat_t stat;
+    int ret = 0;
+
+    if (dt_mem_track_enable() < 0 || !dt_mem_track_enabled()) {
+        ret = -1;
+    }
+    a = (uint8_t *)dt_malloc(1000);
+    b = (uint8_t *)dt_strdup("abc");
+    a = (uint8_t *)dt_realloc(a, 3000);
+    if (!a || !b || MISALIGNED(a) || MISALIGNED(b) || strcmp((char *)b, "abc")) {
+        ret = -1;
+    }
+    dt_mem_track_total(&stat);
+    if (stat.live != 3004 || stat.peak != 3004 || stat.count != 3) {
+        ret = -1;
+    }
+    dt_mem_track_dump(0);
+
+    dt_free(a);
+    dt_free(b);
+    dt_mem_track_total(&stat);
+    if (stat.live != 0 || stat.count != 3) {
+        ret = -1;
+    }
+    dt_info(TAG, "track test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+/* failed growth keeps the old block, dt_realloc_f frees it exactly once */
+static int test_oom(void)
+{
+    dt_mem_stat_t before, stat;
+    uint8_t *p, *q;
+    int i, ret = 0;
+
+    dt_mem_track_total(&before);
+    p = (uint8_t *)dt_malloc(64);
+    if (!p) {
+        return -1;
+    }
+    memset(p, 0x5a, 64);
+    dt_max_alloc(4096);
+    q = (uint8_t *)dt_realloc(p, 1 << 20);
+    if (q || dt_malloc(1 << 20)) {
+        ret = -1;
+    }
+    for (i = 0; i < 64; i++) {
+        if (p[i] != 0x5a) {
+            ret = -1;
+        }
+    }
+    q = (uint8_t *)dt_realloc_f(p, 1 << 10, 1 << 10);
+    dt_max_alloc(INT_MAX);
+    dt_mem_track_total(&stat);
+    if (q || stat.live != before.live) {
+        ret = -1;
+    }
+    dt_info(TAG, "oom test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= test_track();
+    ret |= test_align();        // with tracking on: header keeps alignment
+    ret |= test_oom();
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_mpmc.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "dt_mpmc.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-MPMC"
+
+#define THREADS   4
+#define PER_THREAD 1000000
+#define BATCH     16
+#define DT_BATCH_LEFT(left) ((left) < BATCH ? (left) : BATCH)
+
+struct worker {
+    dt_mpmc_queue_t *q;
+    int id;
+    int batch;
+    uint64_t sum;
+    int count;
+};
+
+static void *producer(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    uintptr_t base = (uintptr_t)w->id * PER_THREAD;
+    void *vals[BATCH];
+    int i = 0, j;
+
+    while (i < PER_THREAD) {
+        if (!w->batch) {
+            dt_mpmc_push(w->q, (void *)(base + i + 1));
+            i++;
+            continue;
+        }
+        int n = DT_BATCH_LEFT(PER_THREAD - i);
+        for (j = 0; j < n; j++) {
+            vals[j] = (void *)(base + i + j + 1);
+        }
+        j = 0;
+        while (j < n) {
+            int ret = dt_mpmc_try_push_n(w->q, vals + j, n - j);
+            if (ret == 0) {
+                sched_yield();
+            }
+            j += ret;
+        }
+        i += n;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    void *vals[BATCH];
+    int j;
+
+    while (w->count < PER_THREAD) {
+        if (!w->batch) {
+            w->sum += (uintptr_t)dt_mpmc_pop(w->q);
+            w->count++;
+            continue;
+        }
+        int n = dt_mpmc_try_pop_n(w->q, vals, DT_BATCH_LEFT(PER_THREAD - w->count));
+        if (n == 0) {
+            sched_yield();
+        }
+        for (j = 0; j < n; j++) {
+            w->sum += (uintptr_t)vals[j];
+        }
+        w->count += n;
+    }
+    return NULL;
+}
+
+static int run(int batch)
+{
+    dt_mpmc_queue_t *q = dt_mpmc_queue_new(1024);
+    struct worker prod[THREADS], cons[THREADS];
+    pthread_t tp[THREADS], tc[THREADS];
+    uint64_t sum = 0, expect;
+    int64_t start, cost;
+    int i;
+
+    start = dt_gettime();
+    for (i = 0; i < THREADS; i++) {
+        prod[i].q = cons[i].q = q;
+        prod[i].id = cons[i].id = i;
+        prod[i].batch = cons[i].batch = batch;
+        cons[i].sum = 0;
+        cons[i].count = 0;
+        pthread_create(&tc[i], NULL, consumer, &cons[i]);
+        pthread_create(&tp[i], NULL, producer, &prod[i]);
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(tp[i], NULL);
+        pthread_join(tc[i], NULL);
+        sum += cons[i].sum;
+    }
+    cost = dt_gettime() - start;
+
+    expect = (uint64_t)THREADS * PER_THREAD * (THREADS * PER_THREAD + 1) / 2;
+    dt_info(TAG, "%s: %d ops in %lld us, %.1f Mops/s %s\n", batch ? "batch " : "single",
+            THREADS * PER_THREAD, (long long)cost, (double)THREADS * PER_THREAD / cost,
+            sum == expect ? "" : "SUM MISMATCH");
+    dt_mpmc_queue_free(q);
+    return sum == expect ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= run(0);
+    ret |= run(1);
+    return ret ? 1 : 0;
+}
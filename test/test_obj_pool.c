@@ -0,0 +1,154 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_obj_pool.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dt_obj_pool.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-OBJ-POOL"
+
+#define OBJ_SIZE     72
+#define THREADS      4
+#define THREAD_OPS   500000
+#define THREAD_SLOTS 64
+
+struct obj {
+    uintptr_t owner;
+    uint8_t data[OBJ_SIZE - sizeof(uintptr_t)];
+};
+
+static int test_basic(void)
+{
+    struct dt_mm_pool *mm = dt_mm_pool_create2(1024 * 1024, DT_MM_POOL_SIZE_CLASS);
+    dt_obj_pool_t *pool = dt_obj_pool_create2(mm, OBJ_SIZE, 64, 8, DT_OBJ_POOL_GROW);
+    void *obj[32];
+    int i, ret = 0;
+
+    for (i = 0; i < 32; i++) {
+        obj[i] = dt_obj_pool_get(pool);
+        if (!obj[i] || ((uintptr_t)obj[i] & 63)) {
+            ret = -1;
+        }
+    }
+    // 8 + 16 + 32 objects after two grows
+    if (dt_obj_pool_capacity(pool) != 56) {
+        ret = -1;
+    }
+    if (dt_obj_pool_put(pool, (uint8_t *)obj[0] + 1) == 0) {
+        ret = -1;
+    }
+    for (i = 0; i < 32; i++) {
+        ret |= dt_obj_pool_put(pool, obj[i]);
+    }
+    dt_obj_pool_destroy(pool);
+
+    // fixed pool runs dry
+    pool = dt_obj_pool_create(OBJ_SIZE, 0, 4, 0);
+    for (i = 0; i < 4; i++) {
+        obj[i] = dt_obj_pool_get(pool);
+    }
+    if (dt_obj_pool_get(pool) != NULL) {
+        ret = -1;
+    }
+    dt_obj_pool_destroy(pool);
+    dt_mm_pool_destroy(mm);
+    dt_info(TAG, "basic test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+struct worker_ctx {
+    dt_obj_pool_t *pool;
+    int error;
+};
+
+/* objects are stamped with owner, a double hand-out shows as foreign stamp */
+static void *worker(void *arg)
+{
+    struct worker_ctx *ctx = (struct worker_ctx *)arg;
+    struct obj *slot[THREAD_SLOTS];
+    unsigned int seed = (unsigned int)(uintptr_t)ctx;
+    int i;
+
+    memset(slot, 0, sizeof(slot));
+    for (i = 0; i < THREAD_OPS; i++) {
+        int n = rand_r(&seed) % THREAD_SLOTS;
+        if (slot[n]) {
+            if (slot[n]->owner != (uintptr_t)&slot[n]) {
+                ctx->error = 1;
+            }
+            if (ctx->pool) {
+                dt_obj_pool_put(ctx->pool, slot[n]);
+            } else {
+                free(slot[n]);
+            }
+            slot[n] = NULL;
+            continue;
+        }
+        slot[n] = ctx->pool ? (struct obj *)dt_obj_pool_get(ctx->pool) : (struct obj *)malloc(OBJ_SIZE);
+        if (slot[n]) {
+            slot[n]->owner = (uintptr_t)&slot[n];
+        }
+    }
+    for (i = 0; i < THREAD_SLOTS; i++) {
+        if (slot[i] && ctx->pool) {
+            dt_obj_pool_put(ctx->pool, slot[i]);
+        } else {
+            free(slot[i]);
+        }
+    }
+    return NULL;
+}
+
+static int bench(const char *name, int flags)
+{
+    dt_obj_pool_t *pool = flags >= 0 ? dt_obj_pool_create(OBJ_SIZE, 0, 256, flags) : NULL;
+    struct worker_ctx ctx[THREADS];
+    pthread_t tid[THREADS];
+    int64_t start, cost;
+    int i, error = 0;
+
+    start = dt_gettime();
+    for (i = 0; i < THREADS; i++) {
+        ctx[i].pool = pool;
+        ctx[i].error = 0;
+        pthread_create(&tid[i], NULL, worker, &ctx[i]);
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(tid[i], NULL);
+        error |= ctx[i].error;
+    }
+    cost = dt_gettime() - start;
+    dt_info(TAG, "%-9s: %d threads, %.1f ns/op %s\n", name, THREADS,
+            (double)cost * 1000 / ((int64_t)THREAD_OPS * THREADS), error ? "CORRUPTED" : "");
+    if (pool) {
+        dt_obj_pool_destroy(pool);
+    }
+    return error ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= test_basic();
+    ret |= bench("malloc", -1);
+    ret |= bench("mutex", DT_OBJ_POOL_GROW);
+    ret |= bench("lockfree", DT_OBJ_POOL_GROW | DT_OBJ_POOL_LOCKFREE);
+    return ret ? 1 : 0;
+}
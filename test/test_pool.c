@@ -14,11 +14,125 @@
  * =====================================================================================
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "dt_mm_pool.h"
+#include "dt_time.h"
 #include "dt_log.h"
 
 #define TAG "TEST-POOL"
 
+#define BENCH_SLOTS  256
+#define BENCH_OPS    200000
+#define BENCH_POOL   (64 * 1024 * 1024)
+
+/*
+ * random alloc/free over BENCH_SLOTS live blocks, 64B - 64KB
+ * every block is stamped and checked before free
+ * flags < 0 runs the same pattern on malloc/free
+ */
+static int bench_pool(const char *name, int flags)
+{
+    struct dt_mm_pool *pool = NULL;
+    uint8_t *slot[BENCH_SLOTS];
+    int len[BENCH_SLOTS];
+    int i, fail = 0, ret = 0;
+    int64_t start, cost;
+
+    if (flags >= 0) {
+        pool = dt_mm_pool_create2(BENCH_POOL, flags);
+    }
+    memset(slot, 0, sizeof(slot));
+    srand(1);
+    dt_set_log_level(DT_LOG_ERROR);
+    start = dt_gettime();
+    for (i = 0; i < BENCH_OPS; i++) {
+        int n = rand() % BENCH_SLOTS;
+        if (slot[n]) {
+            if (slot[n][0] != (uint8_t)n || slot[n][len[n] - 1] != (uint8_t)n) {
+                ret = -1;
+            }
+            if (pool) {
+                ret |= dt_mm_pool_free(pool, slot[n]);
+            } else {
+                free(slot[n]);
+            }
+            slot[n] = NULL;
+            continue;
+        }
+        len[n] = 64 + rand() % (64 * 1024);
+        slot[n] = pool ? dt_mm_pool_alloc(pool, len[n]) : (uint8_t *)malloc(len[n]);
+        if (!slot[n]) {
+            fail++;
+            continue;
+        }
+        slot[n][0] = slot[n][len[n] - 1] = (uint8_t)n;
+    }
+    cost = dt_gettime() - start;
+    dt_set_log_level(DT_LOG_INFO);
+    if (pool) {
+        dt_mm_pool_dump(pool);      // fragmentation with live blocks
+    }
+    for (i = 0; i < BENCH_SLOTS; i++) {
+        if (!slot[i]) {
+            continue;
+        }
+        if (!pool) {
+            free(slot[i]);
+        } else if (dt_mm_pool_free(pool, slot[i]) != 0) {
+            dt_error(TAG, "%s: free of live slot %d refused\n", name, i);
+            ret = -1;
+        }
+    }
+    if (pool) {
+        // every neighbour merged back: one free block spanning the arena
+        struct dt_mm_pool_stat stat;
+        dt_mm_pool_get_stat(pool, &stat);
+        if (stat.use_count != 0 || stat.free_count != 1 || stat.largest_free != stat.free_size
+            || stat.free_size + 16 != stat.size) {         // 16: block header
+            dt_error(TAG, "%s: not coalesced, use:%d free:%d/%lld largest:%lld arena:%lld\n", name,
+                     stat.use_count, stat.free_count, (long long)stat.free_size,
+                     (long long)stat.largest_free, (long long)stat.size);
+            ret = -1;
+        }
+    }
+    dt_info(TAG, "%-10s: %d ops in %lld us, %.1f ns/op, alloc fail:%d %s\n", name, BENCH_OPS,
+            (long long)cost, (double)cost * 1000 / BENCH_OPS, fail, ret ? "CORRUPTED" : "");
+    if (pool) {
+        dt_mm_pool_destroy(pool);
+    }
+    return ret;
+}
+
+/* pointers the pool did not hand out must be refused, pool left intact */
+static int test_bad_free(int flags)
+{
+    struct dt_mm_pool *pool = dt_mm_pool_create2(1024 * 1024, flags);
+    uint8_t *a = dt_mm_pool_alloc(pool, 256);
+    uint8_t *b = dt_mm_pool_alloc(pool, 256);
+    uint8_t local[64];
+    int ret = 0;
+
+    if (dt_mm_pool_free(pool, a + 1) == 0 || dt_mm_pool_free(pool, a + 32) == 0
+        || dt_mm_pool_free(pool, b + 128) == 0 || dt_mm_pool_free(pool, local) == 0) {
+        ret = -1;
+    }
+    if (dt_mm_pool_free(pool, a) != 0 || dt_mm_pool_free(pool, b) != 0
+        || dt_mm_pool_free(pool, b) == 0) {
+        ret = -1;
+    }
+    // a refused double free must not hand the block out twice
+    a = dt_mm_pool_alloc(pool, 256);
+    b = dt_mm_pool_alloc(pool, 256);
+    if (!a || !b || a == b || dt_mm_pool_free(pool, a) != 0 || dt_mm_pool_free(pool, b) != 0) {
+        ret = -1;
+    }
+    dt_mm_pool_destroy(pool);
+    dt_info(TAG, "bad free test flags:%x %s\n", flags, ret ? "failed" : "ok");
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
     int64_t total = 10 * 1024 * 1024;
@@ -31,5 +145,16 @@ int main(int argc, char **argv)
     dt_mm_pool_free(pool, tmp);
     dt_mm_pool_dump(pool);
     dt_mm_pool_destroy(pool);
-    return 0;
+
+    int ret = 0;
+    ret |= test_bad_free(0);
+    ret |= test_bad_free(DT_MM_POOL_SIZE_CLASS);
+    ret |= test_bad_free(DT_MM_POOL_THREAD_CACHE);
+    ret |= test_bad_free(DT_MM_POOL_THREAD_CACHE | DT_MM_POOL_SIZE_CLASS);
+    ret |= bench_pool("malloc", -1);
+    ret |= bench_pool("first-fit", 0);
+    ret |= bench_pool("size-class", DT_MM_POOL_SIZE_CLASS);
+    ret |= bench_pool("mmap-thp", DT_MM_POOL_SIZE_CLASS | DT_MM_POOL_HUGEPAGE | DT_MM_POOL_POPULATE);
+    ret |= bench_pool("hugetlb", DT_MM_POOL_SIZE_CLASS | DT_MM_POOL_HUGETLB | DT_MM_POOL_NUMA_NODE(0));
+    return ret ? 1 : 0;
 }
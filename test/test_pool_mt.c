@@ -0,0 +1,118 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_pool_mt.c
+ *    Description:  dt_mm_pool scaling, shared mutex vs thread cache
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dt_macro.h"
+#include "dt_mm_pool.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-POOL-MT"
+
+#define MAX_THREADS  16
+#define THREAD_SLOTS 32
+#define THREAD_OPS   200000
+#define BENCH_POOL   (256 * 1024 * 1024)
+
+struct worker_ctx {
+    struct dt_mm_pool *pool;
+    unsigned int seed;
+    int error;
+};
+
+/* frame-like sizes 1KB - 64KB, every block stamped and checked */
+static void *worker(void *arg)
+{
+    struct worker_ctx *ctx = (struct worker_ctx *)arg;
+    uint8_t *slot[THREAD_SLOTS];
+    int len[THREAD_SLOTS];
+    int i;
+
+    memset(slot, 0, sizeof(slot));
+    for (i = 0; i < THREAD_OPS; i++) {
+        int n = rand_r(&ctx->seed) % THREAD_SLOTS;
+        if (slot[n]) {
+            if (slot[n][0] != (uint8_t)n || slot[n][len[n] - 1] != (uint8_t)n) {
+                ctx->error = 1;
+            }
+            dt_mm_pool_free(ctx->pool, slot[n]);
+            slot[n] = NULL;
+            continue;
+        }
+        len[n] = 1024 + rand_r(&ctx->seed) % (63 * 1024);
+        slot[n] = dt_mm_pool_alloc(ctx->pool, len[n]);
+        if (slot[n]) {
+            slot[n][0] = slot[n][len[n] - 1] = (uint8_t)n;
+        }
+    }
+    for (i = 0; i < THREAD_SLOTS; i++) {
+        if (slot[i]) {
+            dt_mm_pool_free(ctx->pool, slot[i]);
+        }
+    }
+    return NULL;
+}
+
+static int bench_threads(int flags, int nthreads)
+{
+    struct dt_mm_pool *pool = dt_mm_pool_create2(BENCH_POOL, flags);
+    struct worker_ctx ctx[MAX_THREADS];
+    pthread_t tid[MAX_THREADS];
+    int64_t start, cost;
+    int i, error = 0;
+
+    if (!pool) {
+        return -1;
+    }
+    start = dt_gettime();
+    for (i = 0; i < nthreads; i++) {
+        ctx[i].pool = pool;
+        ctx[i].seed = i + 1;
+        ctx[i].error = 0;
+        pthread_create(&tid[i], NULL, worker, &ctx[i]);
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(tid[i], NULL);
+        error |= ctx[i].error;
+    }
+    cost = dt_gettime() - start;
+
+    dt_info(TAG, "%-12s threads:%2d  %.2f Mops/s %s\n",
+            (flags & DT_MM_POOL_THREAD_CACHE) ? "thread-cache" : "mutex", nthreads,
+            (double)THREAD_OPS * nthreads / cost, error ? "CORRUPTED" : "");
+    dt_mm_pool_destroy(pool);
+    return error ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int max = argc > 1 ? atoi(argv[1]) : (int)DT_MAX(4, ncpu);
+    int n, ret = 0;
+
+    if (max > MAX_THREADS) {
+        max = MAX_THREADS;
+    }
+    for (n = 1; n <= max; n *= 2) {
+        ret |= bench_threads(DT_MM_POOL_SIZE_CLASS, n);
+        ret |= bench_threads(DT_MM_POOL_SIZE_CLASS | DT_MM_POOL_THREAD_CACHE, n);
+    }
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_queue.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "dt_queue.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-QUEUE"
+
+#define ITEM_COUNT 100000
+
+static int items[ITEM_COUNT];
+
+static void *producer(void *arg)
+{
+    dt_queue_t *qu = (dt_queue_t *)arg;
+    int i;
+    for (i = 0; i < ITEM_COUNT; i++) {
+        items[i] = i;
+        dt_queue_push_tail_timeout(qu, &items[i], 0);
+    }
+    return NULL;
+}
+
+static int test_blocking(void)
+{
+    dt_queue_t *qu = dt_queue_new();
+    pthread_t tid;
+    int i, ret = 0;
+    int64_t start;
+
+    // timeout on empty queue
+    start = dt_gettime();
+    if (dt_queue_pop_head_timeout(qu, 20) != NULL || dt_gettime() - start < 15 * 1000) {
+        dt_error(TAG, "pop timeout failed\n");
+        ret = -1;
+    }
+
+    // bounded producer vs blocking consumer
+    dt_queue_set_max_length(qu, 16);
+    pthread_create(&tid, NULL, producer, qu);
+    for (i = 0; i < ITEM_COUNT; i++) {
+        int *v = (int *)dt_queue_pop_head_timeout(qu, 1000);
+        if (!v || *v != i) {
+            dt_error(TAG, "pop %d failed\n", i);
+            ret = -1;
+            break;
+        }
+        if (dt_queue_length(qu) > 16) {
+            dt_error(TAG, "max length exceeded\n");
+            ret = -1;
+            break;
+        }
+    }
+    pthread_join(tid, NULL);
+
+    // full queue times out
+    for (i = 0; i < 16; i++) {
+        dt_queue_push_tail(qu, &items[i]);
+    }
+    if (dt_queue_push_tail_timeout(qu, &items[0], 10) != -1) {
+        dt_error(TAG, "push timeout failed\n");
+        ret = -1;
+    }
+    while (dt_queue_pop_head(qu));
+    dt_queue_free(qu, NULL);
+    dt_info(TAG, "blocking test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+static int test_node_cache(void)
+{
+    dt_queue_t *qu = dt_queue_new();
+    dt_queue_stats_t stats;
+    int i, j, ret = 0;
+    int64_t start, cost;
+
+    start = dt_gettime();
+    for (i = 0; i < 1000; i++) {
+        for (j = 0; j < 100; j++) {
+            dt_queue_push_tail(qu, &items[j]);
+        }
+        for (j = 0; j < 100; j++) {
+            dt_queue_pop_head(qu);
+        }
+    }
+    cost = dt_gettime() - start;
+    dt_queue_get_stats(qu, &stats);
+    dt_info(TAG, "100k push/pop: %lld us, node alloc:%llu reuse:%llu cached:%u\n",
+            (long long)cost, (unsigned long long)stats.node_alloc,
+            (unsigned long long)stats.node_reuse, stats.node_cached);
+    if (stats.node_alloc != 100 || stats.node_cached != 100) {
+        ret = -1;
+    }
+
+    dt_queue_set_node_cache(qu, 10);
+    dt_queue_get_stats(qu, &stats);
+    if (stats.node_cached != 10) {
+        ret = -1;
+    }
+    dt_queue_free(qu, NULL);
+    dt_info(TAG, "node cache test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+static int test_batch(void)
+{
+    dt_queue_t *qa = dt_queue_new();
+    dt_queue_t *qb = dt_queue_new();
+    void *data[64];
+    int i, n, ret = 0;
+
+    for (i = 0; i < 64; i++) {
+        data[i] = &items[i];
+    }
+    dt_queue_push_tail_n(qa, data, 32);
+    dt_queue_push_tail_n(qb, data + 32, 32);
+    if (dt_queue_splice_tail(qa, qb) != 32 || dt_queue_length(qa) != 64 || dt_queue_length(qb) != 0) {
+        ret = -1;
+    }
+
+    memset(data, 0, sizeof(data));
+    n = dt_queue_pop_head_n(qa, data, 40);
+    n += dt_queue_pop_head_n(qa, data + n, 40);
+    if (n != 64) {
+        ret = -1;
+    }
+    for (i = 0; i < n; i++) {
+        if (data[i] != &items[i]) {
+            ret = -1;
+        }
+    }
+    dt_queue_free(qa, NULL);
+    dt_queue_free(qb, NULL);
+    dt_info(TAG, "batch test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= test_blocking();
+    ret |= test_node_cache();
+    ret |= test_batch();
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  test_trace.c
+ *    Description:
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dt_trace.h"
+#include "dt_time.h"
+#include "dt_log.h"
+
+#define TAG "TEST-TRACE"
+
+#define THREADS      4
+#define THREAD_OPS   200000
+
+static const char *trace_path = "/tmp/test_trace.bin";
+
+static int test_render(void)
+{
+    char line[512];
+    FILE *fp = tmpfile();
+    int count, ret = 0;
+
+    if (dt_trace_open(trace_path, 0) < 0 || !fp) {
+        return -1;
+    }
+    DT_TRACE(TAG, "int %d uint %u hex %08x char %c\n", -5, 7u, 0xbeef, 'z');
+    DT_TRACE(TAG, "long %ld llong %lld size %zu\n", -1L, 1LL << 40, (size_t)12345);
+    DT_TRACE(TAG, "double %.3f exp %e str [%s] [%-6s] %%\n", 3.14159, 1e10, "abc", "de");
+    DT_TRACE(TAG, "null str %s\n", (char *)NULL);
+    DT_TRACE(TAG, "wide %ls %lc\n", L"dropped", L'x');     // unsupported, no record
+    dt_trace_close();
+
+    count = dt_trace_decode(trace_path, fp);
+    rewind(fp);
+    const char *expect[] = {
+        "int -5 uint 7 hex 0000beef char z\n",
+        "long -1 llong 1099511627776 size 12345\n",
+        "double 3.142 exp 1.000000e+10 str [abc] [de    ] %\n",
+        "null str \n",
+    };
+    int i = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        char *msg = strstr(line, "[" TAG "] ");
+        if (i >= 4 || !msg || strcmp(msg + strlen("[" TAG "] "), expect[i])) {
+            dt_error(TAG, "bad line: %s", line);
+            ret = -1;
+        }
+        i++;
+    }
+    if (count != 4 || i != 4) {
+        ret = -1;
+    }
+    fclose(fp);
+    dt_info(TAG, "render test %s\n", ret ? "failed" : "ok");
+    return ret;
+}
+
+static void *worker(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    int i;
+    for (i = 0; i < THREAD_OPS; i++) {
+        DT_TRACE(TAG, "thread %d op %d name %s\n", id, i, "worker");
+    }
+    return NULL;
+}
+
+/* ring wraps many times, the decoder sees whole records of the last laps only */
+static int test_wrap(void)
+{
+    FILE *fp = tmpfile();
+    pthread_t tid[THREADS];
+    int last[THREADS];
+    char line[512];
+    int64_t start, cost;
+    int i, count, lines = 0, ret = 0;
+
+    if (dt_trace_open(trace_path, 256 * 1024) < 0 || !fp) {
+        return -1;
+    }
+    start = dt_gettime();
+    for (i = 0; i < THREADS; i++) {
+        pthread_create(&tid[i], NULL, worker, (void *)(intptr_t)i);
+    }
+    for (i = 0; i < THREADS; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    cost = dt_gettime() - start;
+    dt_trace_close();
+
+    count = dt_trace_decode(trace_path, fp);
+    rewind(fp);
+    // every line whole, ops of one thread strictly increasing
+    for (i = 0; i < THREADS; i++) {
+        last[i] = -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *msg = strstr(line, "[" TAG "] ");
+        char name[16];
+        int id, op;
+        if (line[0] != '[' || !msg || line[strlen(line) - 1] != '\n'
+            || sscanf(msg + strlen("[" TAG "] "), "thread %d op %d name %15s", &id, &op, name) != 3
+            || strcmp(name, "worker") || id < 0 || id >= THREADS || op <= last[id] || op >= THREAD_OPS) {
+            dt_error(TAG, "bad line: %s", line);
+            ret = -1;
+            break;
+        }
+        last[id] = op;
+        lines++;
+    }
+    fclose(fp);
+    if (count <= 0 || lines != count) {
+        ret = -1;
+    }
+    dt_info(TAG, "%d threads, %.1f ns/record, %d records kept %s\n", THREADS,
+            (double)cost * 1000 / ((int64_t)THREADS * THREAD_OPS), count, ret ? "failed" : "ok");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    ret |= test_render();
+    ret |= test_wrap();
+    unlink(trace_path);
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+/*
+ * =====================================================================================
+ *
+ *    Filename   :  dt_trace_decode.c
+ *    Description:  render a dt_trace file as text
+ *    Version    :  1.0
+ *    Created    :  2026-10-17
+ *    Revision   :  none
+ *    Compiler   :  gcc
+ *    Author     :  peter-s
+ *    Email      :  peter_future@outlook.com
+ *    Company    :  dt
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+
+#include "dt_trace.h"
+
+int main(int argc, char **argv)
+{
+    int count;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s trace_file\n", argv[0]);
+        return 2;
+    }
+    count = dt_trace_decode(argv[1], stdout);
+    if (count < 0) {
+        fprintf(stderr, "%s: not a trace file\n", argv[1]);
+        return 1;
+    }
+    fprintf(stderr, "%d records\n", count);
+    return 0;
+}